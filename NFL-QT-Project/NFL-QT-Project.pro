@@ -1,8 +1,11 @@
-QT       += core gui
+QT       += core gui network
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
-CONFIG += c++11
+CONFIG += c++17
+
+# The command line version (cli/nflquery.pro) is built from the same files,
+# without the GUI ones, as its own project.
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -15,19 +18,51 @@ SOURCES += \
     Eddie.cpp \
     MeatHandler.cpp \
     loginwindow.cpp \
+    capacityaggregate.cpp \
+    completionindex.cpp \
     main.cpp \
     mainwindow.cpp \
     csv.cpp \
+    csvscan.cpp \
+    datasetloader.cpp \
+    dictionary.cpp \
+    facetindex.cpp \
+    filterexpression.cpp \
+    groupsummary.cpp \
+    mappedfile.cpp \
     nfldatatable.cpp \
+    nfltablemodel.cpp \
+    parallel.cpp \
+    queryservice.cpp \
+    searchindex.cpp \
+    snapshot.cpp \
     sort.cpp \
+    teamquery.cpp \
+    teamrecord.cpp \
     utils.cpp
 
 HEADERS += \
     loginwindow.h \
     mainwindow.h \
+    capacityaggregate.h \
+    completionindex.h \
     csv.h \
+    csvscan.h \
+    datasetloader.h \
+    dictionary.h \
+    facetindex.h \
+    filterexpression.h \
+    groupsummary.h \
+    mappedfile.h \
     nfldatatable.h \
+    nfltablemodel.h \
+    parallel.h \
+    queryservice.h \
+    searchindex.h \
+    snapshot.h \
     sort.h \
+    teamquery.h \
+    teamrecord.h \
     utils.h
 
 FORMS += \
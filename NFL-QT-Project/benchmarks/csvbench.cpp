@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "csv.h"
+#include "csvscan.h"
+
+// Compares how many bytes per second the original stream reader, the scanner
+// based buffer reader (with each scan kernel) and the parallel reader get
+// through.
+//
+// Usage: csvbench [megabytes]
+
+namespace {
+    // Builds a csv file that looks like a (much larger) NFL Information.csv,
+    // with quoted capacities and the occasional escaped quote thrown in.
+    std::string makeInput(std::size_t bytes) {
+        static const char* const rows[] = {
+            "Arizona Cardinals,State Farm Stadium,\"63,400\",Glendale,Arizona,National Football Conference,NFC West,Bermuda Grass,Retractable,2006\r\n",
+            "Baltimore Ravens,M&T Bank Stadium,\"71,008\",Baltimore,Maryland,American Football Conference,AFC North,Bermuda Grass,Open,1998\r\n",
+            "Chicago Bears,\"Soldier Field, \"\"The Bear Den\"\"\",\"61,500\",Chicago,Illinois,National Football Conference,NFC North,Kentucky Bluegrass,Open,1924\r\n",
+            "San Diego Sailors,Qualcomm Stadium,71500,San Diego,California,American Football Conference,AFC West,Bermuda Grass,Open,2022\r\n"
+        };
+
+        std::string input;
+        input.reserve(bytes + 256);
+        for (std::size_t i = 0; input.size() < bytes; i++) {
+            input += rows[i % 4];
+        }
+        return input;
+    }
+
+    template <typename Function>
+    void report(const char* name, std::size_t bytes, Function run) {
+        // Run it once first so the input is in the cache for every reader.
+        run();
+
+        const int runs = 3;
+        auto start = std::chrono::steady_clock::now();
+        std::size_t rows = 0;
+        for (int i = 0; i < runs; i++) {
+            rows = run();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / runs;
+
+        std::cout << std::left << std::setw(24) << name
+                  << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (bytes / seconds / (1024 * 1024)) << " MB/s"
+                  << std::setw(12) << rows << " rows" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const std::string input = makeInput(megabytes * 1024 * 1024);
+
+    std::cout << "Parsing " << input.size() << " bytes" << std::endl;
+
+    report("readStream (istream)", input.size(), [&input]() {
+        std::istringstream stream(input, std::ios::in | std::ios::binary);
+        std::vector<std::vector<std::string>> output;
+        csv::readStream(stream, output, 0, true);
+        return output.size();
+    });
+
+    const csv::ScanKernel best = csv::scanKernel();
+    for (csv::ScanKernel kernel : {csv::ScanKernel::Scalar, csv::ScanKernel::SSE2, csv::ScanKernel::AVX2}) {
+        if (!csv::scanKernelSupported(kernel)) {
+            continue;
+        }
+        csv::setScanKernel(kernel);
+
+        std::string name = std::string("readBuffer (") + csv::scanKernelName(kernel) + ")";
+        report(name.c_str(), input.size(), [&input]() {
+            std::vector<std::vector<std::string_view>> output;
+            std::deque<std::string> unescaped;
+            csv::readBuffer(input, output, unescaped, 0, true);
+            return output.size();
+        });
+    }
+    csv::setScanKernel(best);
+
+    report("readBufferParallel", input.size(), [&input]() {
+        std::size_t rows = 0;
+        csv::readBufferParallel(input, [&rows](std::size_t, std::size_t, const std::vector<std::string_view>&) {
+            rows++;
+            return true;
+        }, 0, true);
+        return rows;
+    });
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+# Stand alone benchmark for the csv readers. Build it separately from the
+# main project (qmake csvbench.pro) and run it from a terminal.
+TEMPLATE = app
+CONFIG += console c++17 thread
+CONFIG -= app_bundle qt
+
+INCLUDEPATH += ../h-files
+
+SOURCES += \
+    csvbench.cpp \
+    ../cpp-files/csv.cpp \
+    ../cpp-files/csvscan.cpp \
+    ../cpp-files/mappedfile.cpp \
+    ../cpp-files/parallel.cpp
+
+HEADERS += \
+    ../h-files/csv.h \
+    ../h-files/csvscan.h \
+    ../h-files/mappedfile.h \
+    ../h-files/parallel.h
@@ -0,0 +1,331 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "filterexpression.h"
+
+// Checks FilterExpression against working out the same filters the slow way.
+// Random filters are made up as trees, typed out with random spacing, case,
+// brackets and ways of writing the same operator or number, and then parsed,
+// compiled and run over random rows. Each row's bit has to match checking the
+// tree against the row directly. More rows are then added with values the
+// dictionaries haven't seen yet, and only those are run through the same
+// compiled filters, so the tables of which codes pass have to grow to match.
+// The same tree typed out two ways also has to give the same key.
+//
+// Usage: filtercheck [rows] [filters]
+
+namespace {
+    std::uint32_t seed = 12345;
+
+    std::uint32_t nextRandom() {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) & 0xFFFFFF;
+    }
+
+    template <typename T, std::size_t N>
+    const T& pick(const T (&items)[N]) {
+        return items[nextRandom() % N];
+    }
+
+    // Small sets of values, so that = and != often go both ways. The last few
+    // of each encoded set only turn up in the rows added later.
+    const char* const teams[] = {"Bears", "bears", "Lions", "Packers", "Vikings", "Jets", "Giants"};
+    const char* const stadiums[] = {"Soldier Field", "Ford Field", "Lambeau Field", "MetLife Stadium", "Arrowhead"};
+    const char* const cities[] = {"Chicago", "Detroit", "Green Bay", "Minneapolis", "East Rutherford"};
+    const char* const states[] = {"Illinois", "Michigan", "Wisconsin", "Minnesota", "New Jersey"};
+    const char* const conferences[] = {"American Football Conference", "National Football Conference", "United Football League"};
+    const char* const divisions[] = {"AFC East", "AFC West", "NFC North", "NFC South", "UFL XFL", "UFL USFL"};
+    const char* const surfaces[] = {"Bermuda Grass", "FieldTurf", "Kentucky Bluegrass", "Hellas Matrix", "AstroTurf"};
+    const char* const roofs[] = {"Open", "Fixed", "Retractable", "Dome", "Canopy"};
+    const int firstLateCode[COLUMN_COUNT] = {0, 0, 0, 0, 0, 2, 4, 3, 3, 0};
+
+    // Texts to compare the columns with, including ones that no row has.
+    const char* const otherTexts[] = {"", "a", "zzz", "Field", "NFC", "open ", "Chicago!"};
+
+    // The names each column can be typed as.
+    const char* const columnNames[COLUMN_COUNT][3] = {
+        {"team", "TeamName", "team_name"},
+        {"stadium", "StadiumName", "stadium"},
+        {"capacity", "SeatingCapacity", "CAPACITY"},
+        {"city", "City", "city"},
+        {"state", "State", "STATE"},
+        {"conference", "Conference", "conference"},
+        {"division", "Division", "DIVISION"},
+        {"surface", "SurfaceType", "surface_type"},
+        {"roof", "RoofType", "StadiumRoofType"},
+        {"year", "YearOpened", "dateopened"}
+    };
+
+    std::string randomCase(std::string text) {
+        for (char& letter : text) {
+            const std::uint32_t choice = nextRandom() % 3;
+            letter = choice == 0 ? static_cast<char>(std::toupper(letter)) : choice == 1 ? static_cast<char>(std::tolower(letter)) : letter;
+        }
+        return text;
+    }
+
+    // Makes a row. Late rows can have the values the dictionaries haven't seen yet.
+    TeamRecord makeRecord(bool late) {
+        auto value = [late](const char* const* values, int count, int column) {
+            const int known = late || firstLateCode[column] == 0 ? count : firstLateCode[column];
+            return std::string(values[nextRandom() % known]);
+        };
+
+        const std::string fields[COLUMN_COUNT] = {
+            value(teams, 7, 0),
+            value(stadiums, 5, 1),
+            std::to_string(60000 + nextRandom() % 11000),
+            value(cities, 5, 3),
+            value(states, 5, 4),
+            value(conferences, 3, 5),
+            value(divisions, 6, 6),
+            value(surfaces, 5, 7),
+            value(roofs, 5, 8),
+            std::to_string(1990 + nextRandom() % 30)
+        };
+        std::vector<std::string_view> views(fields, fields + COLUMN_COUNT);
+
+        TeamRecord record;
+        if (!TeamRecord::fromFields(views, record)) {
+            std::cout << "Could not make a row" << std::endl;
+            std::exit(1);
+        }
+        return record;
+    }
+
+    enum class Kind { Or, And, Not, Compare };
+
+    struct Node {
+        Kind kind;
+        std::vector<std::unique_ptr<Node>> children;
+
+        Column column;
+        int op;
+        std::uint32_t number;
+        std::string text;
+    };
+
+    const char* const operators[][2] = {{"=", "=="}, {"!=", "<>"}, {"<", "<"}, {"<=", "<="}, {">", ">"}, {">=", ">="}};
+
+    std::unique_ptr<Node> makeComparison() {
+        std::unique_ptr<Node> node(new Node());
+        node->kind = Kind::Compare;
+        node->column = static_cast<Column>(nextRandom() % COLUMN_COUNT);
+        node->op = static_cast<int>(nextRandom() % 6);
+        node->number = 0;
+
+        switch (node->column) {
+        case Column::SeatingCapacity: node->number = nextRandom() % 4 == 0 ? nextRandom() : 60000 + nextRandom() % 11000; break;
+        case Column::YearOpened: node->number = 1985 + nextRandom() % 40; break;
+        case Column::TeamName: node->text = pick(teams); break;
+        case Column::StadiumName: node->text = pick(stadiums); break;
+        case Column::City: node->text = pick(cities); break;
+        case Column::State: node->text = pick(states); break;
+        case Column::Conference: node->text = pick(conferences); break;
+        case Column::Division: node->text = pick(divisions); break;
+        case Column::SurfaceType: node->text = pick(surfaces); break;
+        case Column::RoofType: node->text = pick(roofs); break;
+        }
+        if (!isNumericColumn(node->column)) {
+            node->text = nextRandom() % 5 == 0 ? std::string(pick(otherTexts)) : randomCase(node->text);
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> makeTree(int depth) {
+        const std::uint32_t choice = depth > 4 ? 3 : nextRandom() % 4;
+        if (choice == 3) {
+            return makeComparison();
+        }
+
+        std::unique_ptr<Node> node(new Node());
+        node->kind = choice == 0 ? Kind::Or : choice == 1 ? Kind::And : Kind::Not;
+        const std::uint32_t count = node->kind == Kind::Not ? 1 : 2 + nextRandom() % 3;
+        for (std::uint32_t i = 0; i < count; i++) {
+            node->children.push_back(makeTree(depth + 1));
+        }
+        return node;
+    }
+
+    std::string spaces(std::uint32_t fewest) {
+        return std::string(fewest + nextRandom() % 2, ' ');
+    }
+
+    std::string number(std::uint32_t value) {
+        std::string digits = std::to_string(value);
+        if (nextRandom() % 2) {
+            for (int i = static_cast<int>(digits.size()) - 3; i > 0; i -= 3) {
+                digits.insert(static_cast<std::size_t>(i), ",");
+            }
+        }
+        return digits;
+    }
+
+    // Types out :param node: so that it parses back into the same filter.
+    // OR goes below AND, which goes below NOT and comparisons, so a part only
+    // needs brackets if it is lower than where it is, but some get them anyway.
+    std::string type(const Node& node, Kind within) {
+        std::string out;
+        if (node.kind == Kind::Compare) {
+            out = randomCase(columnNames[static_cast<int>(node.column)][nextRandom() % 3]);
+            out += spaces(0) + operators[node.op][nextRandom() % 2] + spaces(0);
+            if (isNumericColumn(node.column)) {
+                out += number(node.number);
+            } else {
+                const char quote = nextRandom() % 2 ? '"' : '\'';
+                out += quote + node.text + quote;
+            }
+        } else if (node.kind == Kind::Not) {
+            out = randomCase("not") + spaces(1) + type(*node.children[0], Kind::Not);
+        } else {
+            const std::string join = node.kind == Kind::And ? "and" : "or";
+            for (std::size_t i = 0; i < node.children.size(); i++) {
+                if (i > 0) {
+                    out += spaces(1) + randomCase(join) + spaces(1);
+                }
+                out += type(*node.children[i], node.kind);
+            }
+        }
+
+        const bool needed = static_cast<int>(node.kind) < static_cast<int>(within) && node.kind != Kind::Compare;
+        if (needed || nextRandom() % 8 == 0) {
+            out = "(" + spaces(0) + out + spaces(0) + ")";
+        }
+        return spaces(0) + out;
+    }
+
+    bool compare(int order, int op) {
+        switch (op) {
+        case 0: return order == 0;
+        case 1: return order != 0;
+        case 2: return order < 0;
+        case 3: return order <= 0;
+        case 4: return order > 0;
+        default: return order >= 0;
+        }
+    }
+
+    bool check(const Node& node, const TeamRecord& record) {
+        switch (node.kind) {
+        case Kind::Not:
+            return !check(*node.children[0], record);
+        case Kind::And:
+            for (const auto& child : node.children) {
+                if (!check(*child, record)) {
+                    return false;
+                }
+            }
+            return true;
+        case Kind::Or:
+            for (const auto& child : node.children) {
+                if (check(*child, record)) {
+                    return true;
+                }
+            }
+            return false;
+        case Kind::Compare:
+            break;
+        }
+
+        if (node.column == Column::SeatingCapacity || node.column == Column::YearOpened) {
+            const std::uint32_t value = node.column == Column::SeatingCapacity ? record.seatingCapacity : record.yearOpened;
+            return compare(value < node.number ? -1 : value > node.number ? 1 : 0, node.op);
+        }
+        return compare(QString::compare(record.text(node.column), QString::fromStdString(node.text), Qt::CaseInsensitive), node.op);
+    }
+
+    struct Filter {
+        std::unique_ptr<Node> tree;
+        std::string text;
+        FilterExpression expression;
+        std::vector<quint64> bits;
+    };
+
+    // Checks every row of :param filter: and shows the first few that are wrong.
+    int countWrong(const Filter& filter, const QVector<const TeamRecord*>& rows) {
+        int wrong = 0;
+        for (int row = 0; row < rows.size(); row++) {
+            const bool expected = check(*filter.tree, *rows[row]);
+            const bool got = ((filter.bits[row / 64] >> (row % 64)) & 1) != 0;
+            if (expected != got && wrong++ < 3) {
+                std::cout << "Row " << row << " should " << (expected ? "" : "not ") << "pass " << filter.text << std::endl;
+            }
+        }
+        return wrong;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 70000;
+    const int filterCount = argc > 2 ? std::atoi(argv[2]) : 50;
+    int failures = 0;
+
+    // Filters that shouldn't compile.
+    const char* const invalid[] = {
+        "", "capacity >", "capacity > \"big\"", "height > 3", "(roof = 'Open'", "roof = 'Open')",
+        "roof = \"Open", "capacity > 99999999999", "roof = 'Open' and", "not", "capacity => 3", "and roof = 'Open'"
+    };
+    for (const char* text : invalid) {
+        FilterExpression expression;
+        QString error;
+        const bool empty = std::string(text).empty();
+        if (expression.compile(text, &error) != empty || (!empty && error.isEmpty())) {
+            std::cout << "\"" << text << "\" should " << (empty ? "" : "not ") << "compile" << std::endl;
+            failures++;
+        }
+    }
+
+    QVector<TeamRecord> records;
+    records.reserve(static_cast<int>(count + count / 2));
+    for (std::size_t i = 0; i < count; i++) {
+        records.push_back(makeRecord(false));
+    }
+    QVector<const TeamRecord*> rows;
+    for (auto it = records.cbegin(); it != records.cend(); it++) {
+        rows.push_back(&*it);
+    }
+
+    std::vector<Filter> filters(static_cast<std::size_t>(filterCount));
+    for (Filter& filter : filters) {
+        filter.tree = makeTree(0);
+        filter.text = type(*filter.tree, Kind::Or);
+
+        QString error;
+        if (!filter.expression.compile(QString::fromStdString(filter.text), &error)) {
+            std::cout << "Could not compile " << filter.text << ": " << error.toStdString() << std::endl;
+            failures++;
+            continue;
+        }
+
+        FilterExpression retyped;
+        const std::string other = type(*filter.tree, Kind::Or);
+        if (!retyped.compile(QString::fromStdString(other)) || retyped.key() != filter.expression.key()) {
+            std::cout << "These should have the same key: " << filter.text << " and " << other << std::endl;
+            failures++;
+        }
+
+        filter.expression.evaluate(rows, 0, filter.bits);
+        failures += countWrong(filter, rows) > 0;
+    }
+
+    // Add rows in a few goes, some with new codes, running only the new ones.
+    for (int round = 0; round < 3; round++) {
+        const int first = rows.size();
+        for (std::size_t i = 0; i < count / 6; i++) {
+            records.push_back(makeRecord(round > 0));
+            rows.push_back(&records.back());
+        }
+        for (Filter& filter : filters) {
+            if (filter.bits.empty()) {
+                continue;
+            }
+            filter.expression.evaluate(rows, first, filter.bits);
+            failures += countWrong(filter, rows) > 0;
+        }
+    }
+
+    std::cout << filters.size() << " filters over " << rows.size() << " rows, " << failures << " wrong" << std::endl;
+    return failures > 0 ? 1 : 0;
+}
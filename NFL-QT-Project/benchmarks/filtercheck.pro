@@ -0,0 +1,22 @@
+# Stand alone check of the filters against working them out the slow way.
+# Build it separately from the main project (qmake filtercheck.pro) and run it
+# from a terminal. It exits with 1 if any filter gave the wrong rows.
+TEMPLATE = app
+QT = core
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../h-files
+
+SOURCES += \
+    filtercheck.cpp \
+    ../cpp-files/dictionary.cpp \
+    ../cpp-files/filterexpression.cpp \
+    ../cpp-files/parallel.cpp \
+    ../cpp-files/teamrecord.cpp
+
+HEADERS += \
+    ../h-files/dictionary.h \
+    ../h-files/filterexpression.h \
+    ../h-files/parallel.h \
+    ../h-files/teamrecord.h
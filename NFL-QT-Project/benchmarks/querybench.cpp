@@ -0,0 +1,198 @@
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QTcpSocket>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "queryservice.h"
+
+// Measures how many requests a second the query service answers and how long
+// they take, with a number of clients that each send one request after another
+// on their own connection. It runs twice: once with a few queries that are
+// asked over and over, which come out of the cache, and once with queries that
+// are all different, which all have to be worked out.
+//
+// Usage: querybench [connections] [seconds] [rows]
+//
+// With 0 rows it measures the service of the NFL app, which has to be running
+// with Serve Queries checked, instead of starting its own with that many made
+// up teams.
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    // Builds teams that look like the ones in NFL Information.csv.
+    void makeRecords(std::size_t count, QVector<TeamRecord>& out) {
+        static const char* const conferences[] = {"American Football Conference", "National Football Conference"};
+        static const char* const surfaces[] = {"Bermuda Grass", "FieldTurf", "Kentucky Bluegrass", "UBU Speed Series S5-M"};
+        static const char* const roofs[] = {"Open", "Fixed", "Retractable"};
+
+        std::uint32_t seed = 12345;
+        auto random = [&seed]() {
+            seed = seed * 1103515245 + 12345;
+            return (seed >> 8) & 0xFFFFFF;
+        };
+
+        out.reserve(static_cast<int>(count));
+        for (std::size_t i = 0; i < count; i++) {
+            const std::string fields[COLUMN_COUNT] = {
+                "Team " + std::to_string(i),
+                "Stadium " + std::to_string(random() % (count / 2 + 1)),
+                std::to_string(40000 + random() % 50000),
+                "City " + std::to_string(random() % 5000),
+                "State " + std::to_string(random() % 50),
+                conferences[random() % 2],
+                "Division " + std::to_string(random() % 8),
+                surfaces[random() % 4],
+                roofs[random() % 3],
+                std::to_string(1900 + random() % 125)
+            };
+            std::vector<std::string_view> views(fields, fields + COLUMN_COUNT);
+
+            TeamRecord record;
+            TeamRecord::fromFields(views, record);
+            out.push_back(record);
+        }
+    }
+
+    // The results of one client.
+    struct ClientResult {
+        std::vector<double> latencies;
+        int failures = 0;
+    };
+
+    // Sends the targets one after another (starting at the first one) on one
+    // connection until the deadline, timing each one.
+    void runClient(quint16 port, const std::vector<std::string>& targets, std::size_t first, Clock::time_point deadline, ClientResult& result) {
+        QTcpSocket socket;
+        socket.connectToHost("127.0.0.1", port);
+        if (!socket.waitForConnected(5000)) {
+            result.failures++;
+            return;
+        }
+
+        QByteArray buffer;
+        for (std::size_t next = first; Clock::now() < deadline; next++) {
+            const std::string request = "GET " + targets[next % targets.size()] + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            const Clock::time_point start = Clock::now();
+            socket.write(request.c_str());
+
+            // Read the headers, then as much of the body as they say there is.
+            int end;
+            while ((end = buffer.indexOf("\r\n\r\n")) < 0) {
+                if (!socket.waitForReadyRead(5000)) {
+                    result.failures++;
+                    return;
+                }
+                buffer += socket.readAll();
+            }
+            const QByteArray head = buffer.left(end).toLower();
+            const int lengthAt = head.indexOf("content-length:");
+            const int length = lengthAt < 0 ? 0 : head.mid(lengthAt + 15, head.indexOf('\r', lengthAt) - lengthAt - 15).trimmed().toInt();
+            buffer.remove(0, end + 4);
+            while (buffer.size() < length) {
+                if (!socket.waitForReadyRead(5000)) {
+                    result.failures++;
+                    return;
+                }
+                buffer += socket.readAll();
+            }
+            buffer.remove(0, length);
+
+            result.latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            if (!head.startsWith("http/1.1 200")) {
+                result.failures++;
+            }
+        }
+    }
+
+    void measure(const char* name, quint16 port, int connections, int seconds, const std::vector<std::string>& targets) {
+        std::vector<ClientResult> results(connections);
+        std::vector<std::thread> clients;
+        const Clock::time_point deadline = Clock::now() + std::chrono::seconds(seconds);
+        for (int i = 0; i < connections; i++) {
+            // Start each client at a different part of the targets, so they
+            // aren't all asking the same thing at the same time.
+            clients.emplace_back(runClient, port, std::cref(targets), targets.size() * i / connections, deadline, std::ref(results[i]));
+        }
+
+        std::vector<double> latencies;
+        int failures = 0;
+        for (int i = 0; i < connections; i++) {
+            clients[i].join();
+            latencies.insert(latencies.end(), results[i].latencies.begin(), results[i].latencies.end());
+            failures += results[i].failures;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        auto percentile = [&latencies](double fraction) {
+            return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(latencies.size() * fraction))];
+        };
+        std::cout << std::left << std::setw(10) << name << std::right
+                  << std::setw(10) << latencies.size() << " requests"
+                  << std::setw(10) << std::fixed << std::setprecision(0) << latencies.size() / static_cast<double>(seconds) << " req/s"
+                  << std::setw(9) << std::setprecision(2) << percentile(0.5) << " ms p50"
+                  << std::setw(9) << percentile(0.99) << " ms p99"
+                  << std::setw(6) << failures << " failed" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    const int connections = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+    const std::size_t count = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100000;
+
+    // The service answers on the thread pool, but it accepts connections from
+    // this thread's event loop, so the clients are run from another thread.
+    QueryService service;
+    QVector<TeamRecord> records;
+    quint16 port = QueryService::DEFAULT_PORT;
+    if (count > 0) {
+        makeRecords(count, records);
+        service.setLists(records, QVector<TeamRecord>());
+        if (!service.start(0)) {
+            std::cout << "Could not start the service: " << service.errorString().toStdString() << std::endl;
+            return 1;
+        }
+        port = service.serverPort();
+        std::cout << "Serving " << records.size() << " rows on port " << port << std::endl;
+    }
+
+    const std::vector<std::string> cached = {
+        "/teams?limit=20",
+        "/teams?sort=capacity:desc&limit=20",
+        "/teams?filter=roof%20%3D%20%22Retractable%22%20AND%20capacity%20%3E%2065000&limit=20",
+        "/teams?search=stadium%2012&limit=20",
+        "/teams?sort=state,city&offset=100&limit=20",
+        "/summary?group=conference",
+        "/summary?group=division,roof",
+        "/summary?group=roof&filter=year%20%3E%3D%202000"
+    };
+
+    // Every one of these is different, so none of them are in the cache.
+    std::vector<std::string> uncached;
+    for (int i = 0; i < 200000; i++) {
+        std::string target = "/teams?limit=20&filter=capacity%20%3E%20" + std::to_string(40000 + i % 50000) + "&offset=" + std::to_string(i / 50000);
+        if (i % 2 == 0) {
+            target += "&sort=capacity:desc";
+        }
+        uncached.push_back(target);
+    }
+
+    std::thread driver([&]() {
+        std::cout << connections << " connections, " << seconds << " seconds each" << std::endl;
+        measure("Cached", port, connections, seconds, cached);
+        measure("Uncached", port, connections, seconds, uncached);
+        QMetaObject::invokeMethod(&app, "quit", Qt::QueuedConnection);
+    });
+    app.exec();
+    driver.join();
+
+    return 0;
+}
@@ -0,0 +1,33 @@
+# Stand alone load generator for the query service. Build it separately from
+# the main project (qmake querybench.pro) and run it from a terminal.
+TEMPLATE = app
+QT = core network
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../h-files
+
+SOURCES += \
+    querybench.cpp \
+    ../cpp-files/capacityaggregate.cpp \
+    ../cpp-files/dictionary.cpp \
+    ../cpp-files/filterexpression.cpp \
+    ../cpp-files/groupsummary.cpp \
+    ../cpp-files/parallel.cpp \
+    ../cpp-files/queryservice.cpp \
+    ../cpp-files/searchindex.cpp \
+    ../cpp-files/sort.cpp \
+    ../cpp-files/teamquery.cpp \
+    ../cpp-files/teamrecord.cpp
+
+HEADERS += \
+    ../h-files/capacityaggregate.h \
+    ../h-files/dictionary.h \
+    ../h-files/filterexpression.h \
+    ../h-files/groupsummary.h \
+    ../h-files/parallel.h \
+    ../h-files/queryservice.h \
+    ../h-files/searchindex.h \
+    ../h-files/sort.h \
+    ../h-files/teamquery.h \
+    ../h-files/teamrecord.h
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "searchindex.h"
+
+// Times typing searches into a large table one letter at a time and then
+// deleting them again, the way the search box runs them, and shows how long
+// each keystroke took by the length of the search. The keystrokes are spaced
+// out (by 100 milliseconds by default, about as fast as people type), since
+// the index uses the time in between to get ready for the next one.
+//
+// Usage: searchbench [rows] [milliseconds between keystrokes]
+
+namespace {
+    std::uint32_t seed = 12345;
+
+    std::uint32_t nextRandom() {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) & 0xFFFFFF;
+    }
+
+    // Makes up a word out of a few syllables, so that lots of rows share
+    // trigrams the way real names do.
+    std::string makeWord() {
+        static const char* const syllables[] = {
+            "ka", "lo", "mi", "ra", "den", "vor", "tus", "bel", "qui", "zan",
+            "pe", "gor", "lin", "sha", "tro", "mak", "ev", "ul", "ni", "bor",
+            "cas", "fen", "dri", "hal", "jun", "wex", "yor", "pla", "ston", "mer"
+        };
+
+        std::string word;
+        const std::uint32_t count = 2 + nextRandom() % 3;
+        for (std::uint32_t i = 0; i < count; i++) {
+            word += syllables[nextRandom() % 30];
+        }
+        word[0] = static_cast<char>(std::toupper(word[0]));
+        return word;
+    }
+
+    void makeRecords(std::size_t count, QVector<TeamRecord>& out) {
+        static const char* const conferences[] = {"American Football Conference", "National Football Conference"};
+        static const char* const surfaces[] = {"Bermuda Grass", "FieldTurf", "Kentucky Bluegrass", "UBU Speed Series S5-M"};
+        static const char* const roofs[] = {"Open", "Fixed", "Retractable"};
+
+        out.reserve(static_cast<int>(count));
+        for (std::size_t i = 0; i < count; i++) {
+            const std::string fields[COLUMN_COUNT] = {
+                makeWord() + " " + makeWord(),
+                makeWord() + " Stadium",
+                std::to_string(40000 + nextRandom() % 50000),
+                makeWord(),
+                makeWord(),
+                conferences[nextRandom() % 2],
+                "Division " + std::to_string(nextRandom() % 8),
+                surfaces[nextRandom() % 4],
+                roofs[nextRandom() % 3],
+                std::to_string(1900 + nextRandom() % 125)
+            };
+            std::vector<std::string_view> views(fields, fields + COLUMN_COUNT);
+
+            TeamRecord record;
+            TeamRecord::fromFields(views, record);
+            out.push_back(record);
+        }
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double search(SearchIndex& index, const std::string& text) {
+        auto start = std::chrono::steady_clock::now();
+        index.search(QString::fromStdString(text));
+        return millisecondsSince(start);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::chrono::milliseconds pause(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100);
+    const int searches = 50;
+    const std::size_t longest = 20;
+
+    QVector<TeamRecord> records;
+    makeRecords(count, records);
+
+    QVector<const TeamRecord*> rows;
+    rows.reserve(records.size());
+    for (auto it = records.cbegin(); it != records.cend(); it++) {
+        rows.push_back(&*it);
+    }
+
+    std::cout << "Searching " << rows.size() << " rows" << std::endl;
+
+    // Adding the rows only copies them, and the first search waits for the
+    // rest of the indexing.
+    SearchIndex index;
+    auto start = std::chrono::steady_clock::now();
+    index.add(rows);
+    std::cout << "Adding  " << std::setw(10) << std::fixed << std::setprecision(1) << millisecondsSince(start) << " ms" << std::endl;
+    search(index, "");
+    std::cout << "Indexing" << std::setw(10) << millisecondsSince(start) << " ms" << std::endl;
+
+    std::vector<double> total(longest + 1, 0);
+    std::vector<double> worst(longest + 1, 0);
+    std::vector<int> typed(longest + 1, 0);
+    auto time = [&](const std::string& text) {
+        std::this_thread::sleep_for(pause);
+        const double milliseconds = search(index, text);
+        const std::size_t length = std::min(text.size(), longest);
+        total[length] += milliseconds;
+        worst[length] = std::max(worst[length], milliseconds);
+        typed[length]++;
+    };
+
+    for (int i = 0; i < searches; i++) {
+        // Search for part of a team's name, sometimes with a typo in it.
+        std::string target = rows[nextRandom() % rows.size()]->teamName.toStdString();
+        if (nextRandom() % 3 == 0) {
+            target[nextRandom() % target.size()] = 'x';
+        }
+
+        std::string text;
+        for (char letter : target) {
+            text += letter;
+            time(text);
+        }
+        while (!text.empty()) {
+            text.pop_back();
+            time(text);
+        }
+    }
+
+    for (std::size_t length = SearchIndex::MIN_LENGTH; length <= longest; length++) {
+        if (typed[length] == 0) {
+            continue;
+        }
+        std::cout << std::setw(3) << length << " letters"
+                  << std::setw(3) << SearchIndex::allowedEdits(static_cast<int>(length)) << " edits"
+                  << std::setw(10) << std::setprecision(2) << (total[length] / typed[length]) << " ms avg"
+                  << std::setw(10) << worst[length] << " ms worst" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+# Stand alone benchmark for the search index. Build it separately from the main
+# project (qmake searchbench.pro) and run it from a terminal.
+TEMPLATE = app
+QT = core
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../h-files
+
+SOURCES += \
+    searchbench.cpp \
+    ../cpp-files/dictionary.cpp \
+    ../cpp-files/parallel.cpp \
+    ../cpp-files/searchindex.cpp \
+    ../cpp-files/teamrecord.cpp
+
+HEADERS += \
+    ../h-files/dictionary.h \
+    ../h-files/parallel.h \
+    ../h-files/searchindex.h \
+    ../h-files/teamrecord.h
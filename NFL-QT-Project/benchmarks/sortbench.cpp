@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "sort.h"
+
+// Times sorting a large table by a few of the columns with 1, 2, 4 and 8
+// threads, so the parallel sort can be compared with the single threaded one.
+//
+// Usage: sortbench [rows]
+
+namespace {
+    // Builds teams that look like the ones in NFL Information.csv, with enough
+    // different names, cities and capacities that every sort key matters.
+    void makeRecords(std::size_t count, QVector<TeamRecord>& out) {
+        static const char* const conferences[] = {"American Football Conference", "National Football Conference"};
+        static const char* const surfaces[] = {"Bermuda Grass", "FieldTurf", "Kentucky Bluegrass", "UBU Speed Series S5-M"};
+        static const char* const roofs[] = {"Open", "Fixed", "Retractable"};
+
+        std::uint32_t seed = 12345;
+        auto random = [&seed]() {
+            seed = seed * 1103515245 + 12345;
+            return (seed >> 8) & 0xFFFFFF;
+        };
+
+        out.reserve(static_cast<int>(count));
+        for (std::size_t i = 0; i < count; i++) {
+            const std::string fields[COLUMN_COUNT] = {
+                "Team " + std::to_string(random() % (count / 2 + 1)),
+                "Stadium " + std::to_string(random() % (count / 4 + 1)),
+                std::to_string(40000 + random() % 50000),
+                "City " + std::to_string(random() % 5000),
+                "State " + std::to_string(random() % 50),
+                conferences[random() % 2],
+                "Division " + std::to_string(random() % 8),
+                surfaces[random() % 4],
+                roofs[random() % 3],
+                std::to_string(1900 + random() % 125)
+            };
+            std::vector<std::string_view> views(fields, fields + COLUMN_COUNT);
+
+            TeamRecord record;
+            TeamRecord::fromFields(views, record);
+            out.push_back(record);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+    const Column columns[] = {Column::TeamName, Column::SeatingCapacity, Column::State, Column::Conference};
+    const std::size_t threadCounts[] = {1, 2, 4, 8};
+
+    QVector<TeamRecord> records;
+    makeRecords(count, records);
+
+    QVector<const TeamRecord*> rows;
+    rows.reserve(records.size());
+    for (auto it = records.cbegin(); it != records.cend(); it++) {
+        rows.push_back(&*it);
+    }
+
+    std::cout << "Sorting " << rows.size() << " rows" << std::endl;
+
+    for (Column column : columns) {
+        const QVector<SortKey> keys = sortKeysFor(column, true);
+        SortKeyCache cache;
+        std::vector<int> order;
+        double singleThreaded = 0;
+
+        // Rank the text once first, the table keeps its cache between sorts.
+        sortOrder(rows, keys, order, &cache, 1);
+
+        for (std::size_t threads : threadCounts) {
+            const int runs = 5;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < runs; i++) {
+                sortOrder(rows, keys, order, &cache, threads);
+            }
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+            if (threads == 1) {
+                singleThreaded = milliseconds;
+            }
+
+            std::cout << std::left << std::setw(20) << columnName(column)
+                      << std::right << std::setw(3) << threads << " threads"
+                      << std::setw(10) << std::fixed << std::setprecision(1) << milliseconds << " ms"
+                      << std::setw(8) << std::setprecision(2) << (singleThreaded / milliseconds) << "x" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+# Stand alone benchmark for the sort engine. Build it separately from the main
+# project (qmake sortbench.pro) and run it from a terminal.
+TEMPLATE = app
+QT = core
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../h-files
+
+SOURCES += \
+    sortbench.cpp \
+    ../cpp-files/dictionary.cpp \
+    ../cpp-files/parallel.cpp \
+    ../cpp-files/sort.cpp \
+    ../cpp-files/teamrecord.cpp
+
+HEADERS += \
+    ../h-files/dictionary.h \
+    ../h-files/parallel.h \
+    ../h-files/sort.h \
+    ../h-files/teamrecord.h
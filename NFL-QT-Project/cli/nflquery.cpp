@@ -0,0 +1,286 @@
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QStringList>
+#include <cstdio>
+#include <limits>
+#include "filterexpression.h"
+#include "groupsummary.h"
+#include "sort.h"
+#include "teamquery.h"
+#include "utils.h"
+
+// Loads the teams the same way the GUI does, picks some of them out with the
+// same filters, searches and sorts, and prints them (or the totals of groups
+// of them) to standard output as CSV or JSON. Anything that goes wrong is
+// printed to standard error.
+//
+// Usage: nflquery [--original file] [--update file]... [--only-original]
+//                 [--filter expression] [--search text] [--sort column[:desc],...]
+//                 [--group-by column[,column]] [--limit count] [--format csv|json]
+//                 [--time]
+
+
+namespace
+{
+    // The exit codes.
+    const int EXIT_BAD_ARGUMENTS = 1;
+    const int EXIT_LOAD_FAILED = 2;
+
+    const char* const DEFAULT_ORIGINAL = "NFL Information.csv";
+
+    void writeText(FILE* stream, const QString& text)
+    {
+        const QByteArray bytes = text.toUtf8();
+        std::fwrite(bytes.constData(), 1, bytes.size(), stream);
+    }
+
+    void printError(const QString& message)
+    {
+        writeText(stderr, message + "\n");
+    }
+
+    // Prints rows to standard output one at a time, so that nothing has to
+    // hold every row as text at once.
+    class Writer
+    {
+    public:
+        Writer(bool json, const QStringList& names) : json(json), names(names), rowCount(0)
+        {
+            if (this->json)
+            {
+                writeText(stdout, "[");
+            }
+            else
+            {
+                QStringList header;
+                for (auto it = names.cbegin(); it != names.cend(); it++)
+                {
+                    header.append(csvField(*it));
+                }
+                writeText(stdout, header.join(',') + "\n");
+            }
+        }
+
+        void write(const QueryRow& row)
+        {
+            if (this->json)
+            {
+                writeText(stdout, QString(this->rowCount == 0 ? "\n  " : ",\n  ") + jsonObject(this->names, row));
+            }
+            else
+            {
+                QStringList fields;
+                for (auto it = row.values.cbegin(); it != row.values.cend(); it++)
+                {
+                    fields.append(csvField(*it));
+                }
+                writeText(stdout, fields.join(',') + "\n");
+            }
+            this->rowCount++;
+        }
+
+        void finish()
+        {
+            if (this->json)
+            {
+                writeText(stdout, this->rowCount == 0 ? "]\n" : "\n]\n");
+            }
+            std::fflush(stdout);
+        }
+    private:
+        bool json;
+        QStringList names;
+        int rowCount;
+    };
+
+    // Reads :param path: into :param out:, printing what went wrong if it
+    // doesn't work.
+    bool loadFile(const QString& path, QVector<TeamRecord>& out)
+    {
+        LoadError error;
+        if (!readRowsFromFile(path.toStdString(), out, &error))
+        {
+            printError(QString("%1: %2").arg(path, error.message));
+            return false;
+        }
+        return true;
+    }
+
+    void writeRows(bool json, const QVector<const TeamRecord*>& rows, int limit)
+    {
+        Writer writer(json, teamFieldNames());
+        for (int row = 0; row < rows.size() && row < limit; row++)
+        {
+            QueryRow output;
+            teamFields(*rows[row], output);
+            writer.write(output);
+        }
+        writer.finish();
+    }
+
+    void writeGroups(bool json, Column first, int second, const QVector<GroupTotals>& groups, int limit)
+    {
+        Writer writer(json, groupFieldNames(first, second));
+        for (int i = 0; i < groups.size() && i < limit; i++)
+        {
+            QueryRow output;
+            groupFields(groups[i], second, output);
+            writer.write(output);
+        }
+        writer.finish();
+    }
+
+    void printTime(bool enabled, const char* step, QElapsedTimer& timer)
+    {
+        if (enabled)
+        {
+            printError(QString("%1: %2 ms").arg(step).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 2));
+        }
+        timer.restart();
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("nflquery");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints the NFL teams that match a query as CSV or JSON.");
+    parser.addHelpOption();
+
+    const QCommandLineOption originalOption("original", "The file with the original list of teams.", "file", DEFAULT_ORIGINAL);
+    const QCommandLineOption updateOption("update", "A file of teams to add to the original list. Can be given more than once.", "file");
+    const QCommandLineOption onlyOriginalOption("only-original", "Only show the teams in the original list.");
+    const QCommandLineOption filterOption("filter", "Only show the teams that pass a filter, like: roof = \"Retractable\" AND capacity > 65000", "expression");
+    const QCommandLineOption searchOption("search", "Only show the teams with some text in one of their columns, best match first.", "text");
+    const QCommandLineOption sortOption("sort", "Sort by one or more columns, like: state,capacity:desc", "columns");
+    const QCommandLineOption groupOption("group-by", "Show the totals of each group of teams, grouped by one or two columns.", "columns");
+    const QCommandLineOption limitOption("limit", "Show at most this many lines.", "count");
+    const QCommandLineOption formatOption("format", "csv or json.", "format", "csv");
+    const QCommandLineOption timeOption("time", "Print how long each step took to standard error.");
+    parser.addOptions({originalOption, updateOption, onlyOriginalOption, filterOption, searchOption, sortOption, groupOption, limitOption, formatOption, timeOption});
+    parser.process(app);
+
+    // Check everything that was asked for before loading anything.
+    QString error;
+    const QString format = parser.value(formatOption).toLower();
+    if (format != "csv" && format != "json")
+    {
+        printError(QString("Unknown format: %1").arg(format));
+        return EXIT_BAD_ARGUMENTS;
+    }
+    const bool json = format == "json";
+
+    int limit = std::numeric_limits<int>::max();
+    if (parser.isSet(limitOption))
+    {
+        bool okay = false;
+        limit = parser.value(limitOption).toInt(&okay);
+        if (!okay || limit < 0)
+        {
+            printError(QString("Expected a number of lines to show, not %1").arg(parser.value(limitOption)));
+            return EXIT_BAD_ARGUMENTS;
+        }
+    }
+
+    FilterExpression expression;
+    if (parser.isSet(filterOption) && !expression.compile(parser.value(filterOption), &error))
+    {
+        printError(error);
+        return EXIT_BAD_ARGUMENTS;
+    }
+
+    QVector<SortKey> sortKeys;
+    if (parser.isSet(sortOption) && !parseSortKeys(parser.value(sortOption), sortKeys, &error))
+    {
+        printError(error);
+        return EXIT_BAD_ARGUMENTS;
+    }
+
+    Column groupFirst = Column::Conference;
+    int groupSecond = -1;
+    const bool grouping = parser.isSet(groupOption);
+    if (grouping && !parseGroupBy(parser.value(groupOption), groupFirst, groupSecond, &error))
+    {
+        printError(error);
+        return EXIT_BAD_ARGUMENTS;
+    }
+
+    const bool timing = parser.isSet(timeOption);
+    QElapsedTimer timer;
+    timer.start();
+
+    // Load the lists the same way the GUI does: the updates only add the teams
+    // that aren't loaded yet.
+    QVector<TeamRecord> originalList;
+    QVector<TeamRecord> updates;
+    if (!loadFile(parser.value(originalOption), originalList))
+    {
+        return EXIT_LOAD_FAILED;
+    }
+
+    QSet<QString> teamNames;
+    teamNames.reserve(originalList.size());
+    for (auto it = originalList.cbegin(); it != originalList.cend(); it++)
+    {
+        teamNames.insert(it->teamName);
+    }
+
+    const QStringList updateFiles = parser.values(updateOption);
+    for (auto path = updateFiles.cbegin(); path != updateFiles.cend(); path++)
+    {
+        QVector<TeamRecord> readEntries;
+        QStringList duplicates;
+        if (!loadFile(*path, readEntries))
+        {
+            return EXIT_LOAD_FAILED;
+        }
+        mergeUpdates(readEntries, teamNames, updates, &duplicates);
+        if (!duplicates.isEmpty())
+        {
+            printError(QString("%1: these teams are in the file more than once, so only the first of each was added: %2").arg(*path, duplicates.join(", ")));
+        }
+    }
+
+    QVector<const TeamRecord*> rows;
+    rows.reserve(originalList.size() + updates.size());
+    for (auto it = originalList.cbegin(); it != originalList.cend(); it++)
+    {
+        rows.push_back(&*it);
+    }
+    if (!parser.isSet(onlyOriginalOption))
+    {
+        for (auto it = updates.cbegin(); it != updates.cend(); it++)
+        {
+            rows.push_back(&*it);
+        }
+    }
+    printTime(timing, "Loading", timer);
+
+    QVector<const TeamRecord*> selected;
+    selectRows(rows, expression, parser.value(searchOption).trimmed(), sortKeys, rows.size(), selected);
+    printTime(timing, "Selecting", timer);
+
+    if (grouping)
+    {
+        GroupSummary summary(groupFirst, groupSecond);
+        QVector<GroupTotals> groups;
+        summary.update(selected);
+        summary.groups(groups);
+        printTime(timing, "Grouping", timer);
+
+        writeGroups(json, groupFirst, groupSecond, groups, limit);
+    }
+    else
+    {
+        writeRows(json, selected, limit);
+    }
+    printTime(timing, "Writing", timer);
+
+    return 0;
+}
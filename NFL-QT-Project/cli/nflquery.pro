@@ -0,0 +1,42 @@
+# Command line version of the table, for running queries without the GUI (like
+# making reports on a server). It only needs QtCore. Build it separately from
+# the main project (qmake nflquery.pro), since a project can only make one
+# program, and run it with --help to see what it can do.
+TEMPLATE = app
+TARGET = nflquery
+QT = core
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../h-files
+
+SOURCES += \
+    nflquery.cpp \
+    ../cpp-files/capacityaggregate.cpp \
+    ../cpp-files/csv.cpp \
+    ../cpp-files/csvscan.cpp \
+    ../cpp-files/dictionary.cpp \
+    ../cpp-files/filterexpression.cpp \
+    ../cpp-files/groupsummary.cpp \
+    ../cpp-files/mappedfile.cpp \
+    ../cpp-files/parallel.cpp \
+    ../cpp-files/searchindex.cpp \
+    ../cpp-files/sort.cpp \
+    ../cpp-files/teamquery.cpp \
+    ../cpp-files/teamrecord.cpp \
+    ../cpp-files/utils.cpp
+
+HEADERS += \
+    ../h-files/capacityaggregate.h \
+    ../h-files/csv.h \
+    ../h-files/csvscan.h \
+    ../h-files/dictionary.h \
+    ../h-files/filterexpression.h \
+    ../h-files/groupsummary.h \
+    ../h-files/mappedfile.h \
+    ../h-files/parallel.h \
+    ../h-files/searchindex.h \
+    ../h-files/sort.h \
+    ../h-files/teamquery.h \
+    ../h-files/teamrecord.h \
+    ../h-files/utils.h
@@ -0,0 +1,65 @@
+#include "capacityaggregate.h"
+
+
+CapacityAggregate::CapacityAggregate()
+{
+    this->runningTotal = 0;
+}
+
+
+// Adds a team, returning true if it is the first one added with its stadium.
+bool CapacityAggregate::add(const TeamRecord& record)
+{
+    auto found = this->stadiums.find(record.stadiumName);
+
+    if (found == this->stadiums.end())
+    {
+        this->stadiums.insert(record.stadiumName, Stadium{1, record.seatingCapacity});
+        this->runningTotal += record.seatingCapacity;
+        return true;
+    }
+
+    found.value().teams++;
+    return false;
+}
+
+
+/*
+ * Removes a team that was added before. The stadium's capacity only comes off
+ * the total once none of the teams left are using it.
+ */
+void CapacityAggregate::remove(const TeamRecord& record)
+{
+    auto found = this->stadiums.find(record.stadiumName);
+
+    if (found == this->stadiums.end())
+    {
+        return;
+    }
+
+    if (--found.value().teams == 0)
+    {
+        this->runningTotal -= found.value().capacity;
+        this->stadiums.erase(found);
+    }
+}
+
+
+void CapacityAggregate::clear()
+{
+    this->stadiums.clear();
+    this->runningTotal = 0;
+}
+
+
+unsigned long long CapacityAggregate::total() const
+{
+    return this->runningTotal;
+}
+
+
+// Gets how many different stadiums the teams use.
+int CapacityAggregate::stadiumCount() const
+{
+    return this->stadiums.size();
+}
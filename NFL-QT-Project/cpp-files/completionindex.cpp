@@ -0,0 +1,247 @@
+#include "completionindex.h"
+#include <algorithm>
+
+
+CompletionIndex::CompletionIndex()
+{
+    this->clear();
+}
+
+
+// Adds the values :param record: has in each of the completion columns.
+void CompletionIndex::add(const TeamRecord& record)
+{
+    for (auto column = std::begin(COMPLETION_COLUMNS); column != std::end(COMPLETION_COLUMNS); column++)
+    {
+        this->addValue(record.text(*column));
+    }
+}
+
+
+void CompletionIndex::clear()
+{
+    this->values.clear();
+    this->ids.clear();
+    this->nodes.assign(1, Node{-1, 0, 0, -1, -1, 0, {}});
+    this->path.clear();
+}
+
+
+/*
+ * Puts up to :param limit: (at most TOP_COUNT) values that start with
+ * :param prefix: in :param out:, the ones added the most first. It takes the
+ * same time however many values start with the prefix.
+ */
+void CompletionIndex::complete(const QString& prefix, int limit, QStringList& out) const
+{
+    out.clear();
+
+    const QString key = prefix.toCaseFolded();
+    int node = 0;
+    int position = 0;
+
+    while (position < key.size())
+    {
+        node = this->findChild(node, key[position]);
+        if (node < 0)
+        {
+            return;
+        }
+
+        // The prefix can end part way through the node's letters.
+        const Node& child = this->nodes[node];
+        const int length = std::min(child.edgeLength, static_cast<int>(key.size()) - position);
+        for (int i = 1; i < length; i++)
+        {
+            if (this->edgeLetter(child, i) != key[position + i])
+            {
+                return;
+            }
+        }
+        position += length;
+    }
+
+    const Node& found = this->nodes[node];
+    for (int i = 0; i < found.topCount && i < limit; i++)
+    {
+        out.append(this->values[found.top[i]].text);
+    }
+}
+
+
+/*
+ * Counts :param text: one more time, then moves it up the best values of every
+ * node above it. Only its count changed, so it can only move up, and the other
+ * values in each node stay in the same order.
+ */
+void CompletionIndex::addValue(const QString& text)
+{
+    if (text.isEmpty())
+    {
+        return;
+    }
+
+    const QString key = text.toCaseFolded();
+    auto found = this->ids.find(key);
+    int value;
+
+    if (found == this->ids.end())
+    {
+        value = this->values.size();
+        this->values.append(Value{text, key, 1});
+        this->ids.insert(key, value);
+    }
+    else
+    {
+        value = found.value();
+        this->values[value].count++;
+    }
+
+    this->insert(value);
+    for (auto it = this->path.cbegin(); it != this->path.cend(); it++)
+    {
+        this->promote(*it, value);
+    }
+}
+
+
+/*
+ * Finds the node :param value: ends at, adding it to the tree if it isn't there
+ * yet, and leaves the nodes from the root down to it in path. Returns the node.
+ */
+int CompletionIndex::insert(int value)
+{
+    const QString& key = this->values[value].key;
+    int node = 0;
+    int position = 0;
+
+    this->path.assign(1, 0);
+
+    while (position < key.size())
+    {
+        const int child = this->findChild(node, key[position]);
+
+        // Nothing has the rest of the key, so it all goes in a new node.
+        if (child < 0)
+        {
+            const int leaf = static_cast<int>(this->nodes.size());
+            this->nodes.push_back(Node{value, position, static_cast<int>(key.size()) - position, -1, -1, 0, {}});
+
+            int* link = &this->nodes[node].firstChild;
+            while (*link >= 0 && this->edgeLetter(this->nodes[*link], 0).unicode() < key[position].unicode())
+            {
+                link = &this->nodes[*link].nextSibling;
+            }
+            this->nodes[leaf].nextSibling = *link;
+            *link = leaf;
+
+            this->path.push_back(leaf);
+            return leaf;
+        }
+
+        int common = 1;
+        const int length = this->nodes[child].edgeLength;
+        while (common < length && position + common < key.size() && this->edgeLetter(this->nodes[child], common) == key[position + common])
+        {
+            common++;
+        }
+
+        // The key only shares the start of the child's letters, so split the
+        // child in two at the point they differ. The new node has the same
+        // values under it as the child did.
+        if (common < length)
+        {
+            const int middle = static_cast<int>(this->nodes.size());
+            Node split = this->nodes[child];
+            split.edgeLength = common;
+            split.firstChild = child;
+            this->nodes.push_back(split);
+
+            Node& rest = this->nodes[child];
+            rest.edgeStart += common;
+            rest.edgeLength -= common;
+            rest.nextSibling = -1;
+
+            int* link = &this->nodes[node].firstChild;
+            while (*link != child)
+            {
+                link = &this->nodes[*link].nextSibling;
+            }
+            *link = middle;
+
+            node = middle;
+        }
+        else
+        {
+            node = child;
+        }
+
+        position += common;
+        this->path.push_back(node);
+    }
+
+    return node;
+}
+
+
+// Finds the child of :param node: whose letters start with :param letter:, or -1 if there isn't one.
+int CompletionIndex::findChild(int node, QChar letter) const
+{
+    for (int child = this->nodes[node].firstChild; child >= 0; child = this->nodes[child].nextSibling)
+    {
+        if (this->edgeLetter(this->nodes[child], 0) == letter)
+        {
+            return child;
+        }
+    }
+    return -1;
+}
+
+
+QChar CompletionIndex::edgeLetter(const Node& node, int i) const
+{
+    return this->values[node.edgeValue].key[node.edgeStart + i];
+}
+
+
+// Moves :param value:, whose count just went up, into its place in the best values of :param node:.
+void CompletionIndex::promote(int node, int value)
+{
+    Node& best = this->nodes[node];
+
+    int i = std::find(best.top, best.top + best.topCount, value) - best.top;
+    if (i == best.topCount)
+    {
+        if (best.topCount < TOP_COUNT)
+        {
+            best.topCount++;
+        }
+        else if (this->better(value, best.top[TOP_COUNT - 1]))
+        {
+            i = TOP_COUNT - 1;
+        }
+        else
+        {
+            return;
+        }
+        best.top[i] = value;
+    }
+
+    for (; i > 0 && this->better(best.top[i], best.top[i - 1]); i--)
+    {
+        std::swap(best.top[i], best.top[i - 1]);
+    }
+}
+
+
+// Checks if :param first: is offered before :param second:.
+bool CompletionIndex::better(int first, int second) const
+{
+    const Value& a = this->values[first];
+    const Value& b = this->values[second];
+    if (a.count != b.count)
+    {
+        return a.count > b.count;
+    }
+    return a.key < b.key;
+}
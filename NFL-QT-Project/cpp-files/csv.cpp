@@ -1,6 +1,9 @@
-#include <iostream>
+#include <algorithm>
 #include <fstream>
+#include <iostream>
 #include "csv.h"
+#include "csvscan.h"
+#include "parallel.h"
 
 
 namespace csv {
@@ -69,7 +72,9 @@ namespace csv {
                     }
                     break;
                 case '\r':
-                    if (quoted) {
+                    // A quote that was just closed ends the quoted part of the
+                    // entry, so line endings after it are real line endings.
+                    if (quoted && !foundQuote) {
                         item += '\r';
                     }
                     else {
@@ -77,7 +82,7 @@ namespace csv {
                     }
                     break;
                 case '\n':
-                    if (quoted) {
+                    if (quoted && !foundQuote) {
                         item += '\n';
                     }
                     else {
@@ -143,68 +148,552 @@ namespace csv {
         // The number of lines read.
         std::size_t lines = 0;
 
-        // Vector used if strict mode is on so we don't end up pushing anything to
-        // the output vector unless we are sure the input is good.
-        std::vector<std::vector<std::string>> tempOutput;
-
-        // What we use to push_back to depending on the value of :param strict:.
-        std::vector<std::vector<std::string>>& outputVector = (strict ? tempOutput : output);
-
-        std::vector<std::string> nextLine;
+        // Where our lines start in the output. In strict mode lines go straight
+        // into the output and get removed again if the input turns out to be
+        // bad, which saves us from copying every line twice.
+        const std::size_t firstLine = output.size();
 
         while (csvStream.peek() != EOF && (lineCount == 0 || lines < lineCount)) {
-            tokensRead = readLine(csvStream, nextLine);
-            outputVector.push_back(nextLine);
-            nextLine.clear();
+            std::vector<std::string>& nextLine = output.emplace_back();
+            try {
+                tokensRead = readLine(csvStream, nextLine);
+            }
+            catch (...) {
+                output.resize(strict ? firstLine : output.size() - 1);
+                throw;
+            }
             if (lines == 0) {
                 maxTokens = tokensRead;
             }
             if (strict && maxTokens != tokensRead) {
+                output.resize(firstLine);
                 throw std::length_error("Previously got " + std::to_string(maxTokens) + " tokens but the last line had " + std::to_string(tokensRead) + ".");
             }
 
             lines++;
         }
-
-        if (strict) {
-            // If strict is true and we have gotten to this point then the lines should
-            // all be perfectly fine. We can just copy everything now.
-            for (int i = 0; i < outputVector.size(); i++) {
-                output.push_back(outputVector[i]);
-            }
-        }
         return maxTokens;
     }
 
     // Identical to csv:readStream except it takes in a file name instead of a stream.
+    // The file is memory mapped and streamed through csv::readBuffer, so the
+    // only copies made are the final strings placed in :param output:.
     //
     // Throws csv::FileError if the file could not be opened.
     std::size_t readFile(const char* fileName, std::vector<std::vector<std::string>>& output, std::size_t lineCount, bool strict) {
-        std::ifstream csvFile;
+        // Where our lines start in the output so strict mode can undo them.
+        const std::size_t firstLine = output.size();
+
+        try {
+            // Return the maximum number of tokens per line.
+            return readFile(fileName, [&output](std::size_t, std::size_t, const std::vector<std::string_view>& line) {
+                output.emplace_back(line.begin(), line.end());
+                return true;
+            }, lineCount, strict);
+        }
+        catch (...) {
+            if (strict) {
+                output.resize(firstLine);
+            }
+            throw;
+        }
+    }
+
+    // Overload that makes it so that string file names are easily allowed.
+    std::size_t readFile(std::string fileName, std::vector<std::vector<std::string>>& output, std::size_t lineCount, bool strict) {
+        return readFile(fileName.c_str(), output, lineCount, strict);
+    }
+
+    namespace {
+        // Keeps track of where the text of the entry currently being read is.
+        // As long as every character we keep is right after the previous one
+        // the entry is just a slice of the input. The first time that is not
+        // the case (an escaped quote, for example) the entry is copied into
+        // `unescaped` and built up there instead.
+        class FieldBuilder
+        {
+        public:
+            FieldBuilder(std::deque<std::string>& unescaped) : unescaped(unescaped), start(nullptr), end(nullptr), copy(nullptr) {}
+
+            // Starts a new entry whose first character would be at :param at:.
+            void reset(const char* at) {
+                start = end = at;
+                copy = nullptr;
+            }
 
-        // Open the file in binary read mode.
-        csvFile.open(fileName, std::ios::in | std::ios::binary);
+            // Keeps the characters in [:param from:, :param to:) as part of the
+            // entry.
+            void append(const char* from, const char* to) {
+                if (copy) {
+                    copy->append(from, to);
+                }
+                else if (from == end) {
+                    end = to;
+                }
+                else {
+                    copy = &unescaped.emplace_back(start, end);
+                    copy->append(from, to);
+                }
+            }
+
+            // Keeps the character found at :param at: as part of the entry.
+            void append(const char* at) {
+                append(at, at + 1);
+            }
+
+            bool empty() const {
+                return copy ? copy->empty() : start == end;
+            }
+
+            std::string_view view() const {
+                return copy ? std::string_view(*copy) : std::string_view(start, end - start);
+            }
+
+        private:
+            std::deque<std::string>& unescaped;
+            const char* start;
+            const char* end;
+            std::string* copy;
+        };
+    }
+
+    namespace {
+        // Reads the line starting at :param offset: using the offsets of the
+        // structural characters from :param scanner:, and moves :param offset:
+        // to the start of the next line. Text between two structural characters
+        // is always kept as is, so it is added to the entry all at once. The
+        // separator is whichever one the scanner was made with.
+        std::size_t readScannedLine(StructuralScanner& scanner, std::string_view input, std::size_t& offset, std::vector<std::string_view>& output, std::deque<std::string>& unescaped) {
+            const char* const data = input.data();
+            // Output count of how many items have been found on the line.
+            std::size_t count = 0;
+            // See csv::readLine above for what each of these are used for. We
+            // don't need foundCR since we can check the character after a '\r'
+            // the moment we find one.
+            bool quoted = false;
+            bool foundQuote = false;
+            bool lineDone = false;
+
+            FieldBuilder item(unescaped);
+
+            if (offset == input.size()) {
+                return 0;
+            }
+
+            item.reset(data + offset);
+
+            while (!lineDone) {
+                const std::size_t next = scanner.next();
+
+                // Everything up to the next structural character is plain text.
+                item.append(data + offset, data + next);
+                if (next == input.size()) {
+                    offset = next;
+                    break;
+                }
+
+                const char* const current = data + next;
+                offset = next + 1;
+
+                switch (*current) {
+                case '"':
+                    if (quoted) {
+                        if (foundQuote) {
+                            // Both quotes are the same character, so keep the first
+                            // of the two when it is right before this one. That way
+                            // an entry ending in an escaped quote can still be a slice.
+                            foundQuote = false;
+                            item.append(*(current - 1) == '"' ? current - 1 : current);
+                        }
+                        else {
+                            foundQuote = true;
+                        }
+                    }
+                    else if (item.empty()) {
+                        // The text of the entry starts after the opening quote.
+                        quoted = true;
+                        item.reset(data + offset);
+                    }
+                    else {
+                        throw UnexpectedCharacterError("Got unexpected quotation mark.");
+                    }
+                    break;
+                case '\r':
+                    if (quoted && !foundQuote) {
+                        item.append(current);
+                    }
+                    else if (offset == input.size()) {
+                        throw UnexpectedEndOfStreamError("Stream ended while waiting for a '\\n' to match the '\\r'.");
+                    }
+                    else if (data[offset] != '\n') {
+                        throw UnexpectedCharacterError("Expected a '\\n' after the '\r' in an unquoted string, but got\"" + std::to_string(data[offset]) + "\"instead.");
+                    }
+                    // Otherwise the '\n' is the next structural character and
+                    // ends the line.
+                    break;
+                case '\n':
+                    if (quoted && !foundQuote) {
+                        item.append(current);
+                    }
+                    else {
+                        lineDone = true;
+                    }
+                    break;
+                default:
+                    if (!quoted || foundQuote) {
+                        foundQuote = false;
+                        quoted = false;
+                        output.push_back(item.view());
+                        item.reset(data + offset);
+                        count++;
+                    }
+                    else {
+                        item.append(current);
+                    }
+                    break;
+                }
+            }
+            if (quoted && !foundQuote) {
+                throw UnclosedQuoteError("Found a quote that was opened by never closed.");
+            }
+            output.push_back(item.view());
+            count++;
 
-        // Check to see if the file opened.
-        if (csvFile.fail()) {
-            throw FileError("Could not open the file.");
+            return count;
         }
+    }
 
-        // Read the file into the output vector.
-        std::size_t tokens = readStream(csvFile, output, lineCount, strict);
+    // Zero copy version of csv::readLine. Reads a single line from the front of
+    // :param input: and removes it from the view, pushing a view of every item
+    // to the back of :param output:. Items are slices of :param input: unless
+    // they contained escaped quotes, in which case the unescaped text is stored
+    // in :param unescaped: and the view points there instead.
+    //
+    // Follows exactly the same rules and throws exactly the same exceptions as
+    // the stream version.
+    std::size_t readLine(std::string_view& input, std::vector<std::string_view>& output, std::deque<std::string>& unescaped, const char sep) {
+        StructuralScanner scanner(input, sep);
+        std::size_t offset = 0;
 
-        // Ensure we close the file.
-        csvFile.close();
+        std::size_t count = readScannedLine(scanner, input, offset, output, unescaped);
 
-        // Return the maximum number of tokens per line.
-        return tokens;
+        input.remove_prefix(offset);
+        return count;
+    }
+
+    namespace {
+        // Rethrows the exception currently being handled with the number of the
+        // line it happened on (counting from 1) added to the front of the
+        // message. The exception keeps its type so it can be caught the same way.
+        [[noreturn]] void rethrowAtLine(std::size_t line) {
+            const std::string prefix = "Line " + std::to_string(line + 1) + ": ";
+            try {
+                throw;
+            }
+            catch (const UnclosedQuoteError& e) {
+                throw UnclosedQuoteError(prefix + e.what());
+            }
+            catch (const UnexpectedEndOfStreamError& e) {
+                throw UnexpectedEndOfStreamError(prefix + e.what());
+            }
+            catch (const UnexpectedCharacterError& e) {
+                throw UnexpectedCharacterError(prefix + e.what());
+            }
+            catch (const std::length_error& e) {
+                throw std::length_error(prefix + e.what());
+            }
+        }
+
+        // Shared by both versions of csv::readBuffer. Unescaped entries are put
+        // in :param unescaped:, which is emptied after every line unless
+        // :param keepUnescaped: is true.
+        std::size_t visitBuffer(std::string_view input, std::deque<std::string>& unescaped, bool keepUnescaped, const RowVisitor& visitor, std::size_t lineCount, bool strict) {
+            std::size_t maxTokens = 0;
+            std::size_t tokensRead = 0;
+            std::size_t lines = 0;
+
+            // One scanner for the whole buffer so it never scans anything twice.
+            StructuralScanner scanner(input);
+            std::size_t offset = 0;
+
+            // Reused for every line so we aren't allocating for each one.
+            std::vector<std::string_view> nextLine;
+
+            while (offset < input.size() && (lineCount == 0 || lines < lineCount)) {
+                nextLine.clear();
+                if (!keepUnescaped) {
+                    unescaped.clear();
+                }
+
+                try {
+                    tokensRead = readScannedLine(scanner, input, offset, nextLine, unescaped);
+                    if (lines == 0) {
+                        maxTokens = tokensRead;
+                    }
+                    if (strict && maxTokens != tokensRead) {
+                        throw std::length_error("Previously got " + std::to_string(maxTokens) + " tokens but the last line had " + std::to_string(tokensRead) + ".");
+                    }
+                }
+                catch (...) {
+                    rethrowAtLine(lines);
+                }
+
+                lines++;
+                if (!visitor(lines - 1, offset, nextLine)) {
+                    break;
+                }
+            }
+            return maxTokens;
+        }
+    }
+
+    // Streaming version of csv::readBuffer. Instead of collecting every line,
+    // each one is handed to :param visitor: as soon as it has been read, so only
+    // a single line is ever held in memory. The views given to the visitor are
+    // only valid until it returns, and reading stops early if it returns false.
+    //
+    // In strict mode the lines before a bad one will already have been given to
+    // the visitor by the time std::length_error is thrown, so it is up to the
+    // visitor to throw them away if needed.
+    //
+    // Throws std::length_error if in strict mode and the line lengths are not equal.
+    std::size_t readBuffer(std::string_view input, const RowVisitor& visitor, std::size_t lineCount, bool strict) {
+        std::deque<std::string> unescaped;
+        return visitBuffer(input, unescaped, false, visitor, lineCount, strict);
+    }
+
+    // Zero copy version of csv::readStream that reads from an in memory buffer
+    // such as a csv::MappedFile. Behaves the same way, except in strict mode the
+    // lines are added directly to :param output: and removed again if a line
+    // turns out to be the wrong length, instead of going through a second vector.
+    //
+    // Throws std::length_error if in strict mode and the line lengths are not equal.
+    std::size_t readBuffer(std::string_view input, std::vector<std::vector<std::string_view>>& output, std::deque<std::string>& unescaped, std::size_t lineCount, bool strict) {
+        // Where our lines start in the output so strict mode can undo them.
+        const std::size_t firstLine = output.size();
+
+        try {
+            return visitBuffer(input, unescaped, true, [&output](std::size_t, std::size_t, const std::vector<std::string_view>& line) {
+                output.push_back(line);
+                return true;
+            }, lineCount, strict);
+        }
+        catch (...) {
+            if (strict) {
+                output.resize(firstLine);
+            }
+            throw;
+        }
+    }
+
+    // Maps the file into :param output:'s MappedFile and reads it with
+    // csv::readBuffer. The rows are only valid for as long as :param output: is.
+    //
+    // Throws csv::FileError if the file could not be opened.
+    std::size_t readFile(const char* fileName, Document& output, std::size_t lineCount, bool strict) {
+        output.rows.clear();
+        output.unescaped.clear();
+        output.file.open(fileName);
+
+        return readBuffer(output.file.view(), output.rows, output.unescaped, lineCount, strict);
     }
 
     // Overload that makes it so that string file names are easily allowed.
-    std::size_t readFile(std::string fileName, std::vector<std::vector<std::string>>& output, std::size_t lineCount, bool strict) {
+    std::size_t readFile(std::string fileName, Document& output, std::size_t lineCount, bool strict) {
         return readFile(fileName.c_str(), output, lineCount, strict);
     }
 
+    // Maps the file and streams it through :param visitor: with csv::readBuffer.
+    // The file is only mapped for the duration of the call.
+    //
+    // Throws csv::FileError if the file could not be opened.
+    std::size_t readFile(const char* fileName, const RowVisitor& visitor, std::size_t lineCount, bool strict) {
+        MappedFile file(fileName);
+        return readBuffer(file.view(), visitor, lineCount, strict);
+    }
+
+    // Overload that makes it so that string file names are easily allowed.
+    std::size_t readFile(std::string fileName, const RowVisitor& visitor, std::size_t lineCount, bool strict) {
+        return readFile(fileName.c_str(), visitor, lineCount, strict);
+    }
+
+    namespace {
+        // Don't bother splitting up anything smaller than this between threads.
+        const std::size_t MIN_PARALLEL_BYTES = 1024 * 1024;
+        // How much of the input each thread parses at a time. The input is
+        // handled in batches of one chunk per thread so that memory use depends
+        // on the number of threads rather than on the size of the input.
+        const std::size_t CHUNK_BYTES = 4 * 1024 * 1024;
+
+        // Returns the offset of the first line that starts after :param from:,
+        // given whether :param from: is inside of a quoted entry.
+        std::size_t findLineStart(std::string_view input, std::size_t from, bool inQuotes) {
+            for (std::size_t i = from; i < input.size(); i++) {
+                if (input[i] == '"') {
+                    inQuotes = !inQuotes;
+                }
+                else if (input[i] == '\n' && !inQuotes) {
+                    return i + 1;
+                }
+            }
+            return input.size();
+        }
+
+        // Everything one thread read from its chunk of the input. The entries
+        // of every line are stored one after another in `fields`.
+        struct Chunk
+        {
+            std::size_t start;
+            std::size_t end;
+            std::vector<std::string_view> fields;
+            // Where each line's entries end in `fields`.
+            std::vector<std::size_t> lineEnds;
+            // Where the line after each line starts, relative to `start`.
+            std::vector<std::size_t> offsets;
+            std::deque<std::string> unescaped;
+            // Set if the chunk had a bad line in it. The lines before it are
+            // still kept since they have to be given to the visitor first.
+            std::exception_ptr error;
+        };
+
+        void readChunk(std::string_view input, Chunk& chunk) {
+            std::string_view text = input.substr(chunk.start, chunk.end - chunk.start);
+            StructuralScanner scanner(text);
+            std::size_t offset = 0;
+
+            chunk.fields.clear();
+            chunk.lineEnds.clear();
+            chunk.offsets.clear();
+            chunk.unescaped.clear();
+            chunk.error = nullptr;
+
+            try {
+                while (offset < text.size()) {
+                    readScannedLine(scanner, text, offset, chunk.fields, chunk.unescaped);
+                    chunk.lineEnds.push_back(chunk.fields.size());
+                    chunk.offsets.push_back(offset);
+                }
+            }
+            catch (...) {
+                chunk.error = std::current_exception();
+            }
+        }
+    }
+
+    // Multi-threaded version of the streaming csv::readBuffer. The input is cut
+    // into one chunk per thread and every chunk is read at the same time.
+    //
+    // A chunk can't just start anywhere since it might land in the middle of a
+    // quoted entry, so first each thread counts the quotes in its part of the
+    // input. Whether a byte is inside of quotes only depends on how many quotes
+    // came before it, so that tells every chunk exactly where its first line
+    // starts. Once the chunks are read their lines are given to :param visitor:
+    // in the original order, and the exceptions are the same as csv::readBuffer
+    // (including the line they happened on).
+    //
+    // If :param threads: is 0 then one thread per core is used. Small inputs are
+    // just read with csv::readBuffer.
+    //
+    // Throws std::length_error if in strict mode and the line lengths are not equal.
+    std::size_t readBufferParallel(std::string_view input, const RowVisitor& visitor, std::size_t lineCount, bool strict, std::size_t threads) {
+        if (threads == 0) {
+            threads = defaultThreadCount();
+        }
+        if (threads == 1 || input.size() < MIN_PARALLEL_BYTES) {
+            return readBuffer(input, visitor, lineCount, strict);
+        }
+
+        std::size_t maxTokens = 0;
+        std::size_t lines = 0;
+        std::vector<std::string_view> nextLine;
+
+        std::vector<Chunk> chunks(threads);
+        std::vector<std::size_t> quotes(threads);
+
+        // Every batch starts at the start of a line, so never inside of quotes.
+        std::size_t batchStart = 0;
+        while (batchStart < input.size()) {
+            const std::size_t batchSize = std::min(input.size() - batchStart, threads * CHUNK_BYTES);
+            const std::size_t partSize = (batchSize + threads - 1) / threads;
+
+            // Count the quotes in each part of the batch.
+            runTasks(threads, threads, [&](std::size_t i) {
+                const std::size_t from = std::min(batchStart + i * partSize, input.size());
+                const std::size_t to = std::min(from + partSize, input.size());
+                quotes[i] = std::count(input.begin() + from, input.begin() + to, '"');
+            });
+
+            // Move the start of every part forward to the start of a line. The
+            // end of the batch is moved the same way by the last chunk.
+            runTasks(threads, threads, [&](std::size_t i) {
+                std::size_t quotesBefore = 0;
+                for (std::size_t j = 0; j <= i; j++) {
+                    quotesBefore += quotes[j];
+                }
+                const std::size_t to = std::min(batchStart + (i + 1) * partSize, input.size());
+                chunks[i].end = (to == input.size()) ? to : findLineStart(input, to, quotesBefore % 2 == 1);
+            });
+            for (std::size_t i = 0; i < threads; i++) {
+                chunks[i].start = (i == 0) ? batchStart : chunks[i - 1].end;
+                // A line longer than a whole part can swallow the next part.
+                chunks[i].end = std::max(chunks[i].start, chunks[i].end);
+            }
+
+            runTasks(threads, threads, [&](std::size_t i) {
+                readChunk(input, chunks[i]);
+            });
+
+            // Hand everything to the visitor in order. Checking the width here
+            // rather than in the chunks means every line is checked against the
+            // very first line, just like csv::readBuffer.
+            for (auto chunk = chunks.begin(); chunk != chunks.end(); chunk++) {
+                std::size_t lineStart = 0;
+                for (std::size_t i = 0; i < chunk->lineEnds.size(); i++) {
+                    const std::size_t tokensRead = chunk->lineEnds[i] - lineStart;
+                    if (lines == 0) {
+                        maxTokens = tokensRead;
+                    }
+                    if (strict && maxTokens != tokensRead) {
+                        throw std::length_error("Line " + std::to_string(lines + 1) + ": Previously got " + std::to_string(maxTokens) + " tokens but the last line had " + std::to_string(tokensRead) + ".");
+                    }
+
+                    nextLine.assign(chunk->fields.begin() + lineStart, chunk->fields.begin() + chunk->lineEnds[i]);
+                    lineStart = chunk->lineEnds[i];
+
+                    lines++;
+                    if (!visitor(lines - 1, chunk->start + chunk->offsets[i], nextLine) || lines == lineCount) {
+                        return maxTokens;
+                    }
+                }
+
+                if (chunk->error) {
+                    try {
+                        std::rethrow_exception(chunk->error);
+                    }
+                    catch (...) {
+                        rethrowAtLine(lines);
+                    }
+                }
+            }
+
+            batchStart = chunks.back().end;
+        }
+        return maxTokens;
+    }
+
+    // Maps the file and reads it with csv::readBufferParallel.
+    //
+    // Throws csv::FileError if the file could not be opened.
+    std::size_t readFileParallel(const char* fileName, const RowVisitor& visitor, std::size_t lineCount, bool strict, std::size_t threads) {
+        MappedFile file(fileName);
+        return readBufferParallel(file.view(), visitor, lineCount, strict, threads);
+    }
+
+    // Overload that makes it so that string file names are easily allowed.
+    std::size_t readFileParallel(std::string fileName, const RowVisitor& visitor, std::size_t lineCount, bool strict, std::size_t threads) {
+        return readFileParallel(fileName.c_str(), visitor, lineCount, strict, threads);
+    }
+
     //#### Exceptions ####//
 
     CSVException::CSVException(const char* msg) : std::logic_error(msg) {}
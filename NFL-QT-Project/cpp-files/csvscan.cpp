@@ -0,0 +1,247 @@
+#include <cstring>
+#include "csvscan.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CSV_SCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need to be told a function is allowed to use AVX2, MSVC lets
+// any function use it.
+#if defined(CSV_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CSV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CSV_TARGET_AVX2
+#endif
+
+
+namespace csv {
+    namespace {
+        // The scanner looks at the input in blocks of this many bytes, one bit
+        // per byte.
+        const std::size_t BLOCK_SIZE = 64;
+        const std::size_t FIRST_WINDOW = 4 * BLOCK_SIZE;
+        const std::size_t MAX_WINDOW = 1024 * BLOCK_SIZE;
+
+        // One bit per byte of a block for each of the characters we care about.
+        struct BlockMasks
+        {
+            std::uint64_t quotes;
+            std::uint64_t others;
+        };
+
+        inline unsigned int countTrailingZeros(std::uint64_t mask) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, mask);
+            return index;
+#else
+            return __builtin_ctzll(mask);
+#endif
+        }
+
+        // Bit i of the result is the xor of bits 0 through i of :param mask:,
+        // which turns a mask of quotes into a mask of what is between them.
+        inline std::uint64_t prefixXor(std::uint64_t mask) {
+            mask ^= mask << 1;
+            mask ^= mask << 2;
+            mask ^= mask << 4;
+            mask ^= mask << 8;
+            mask ^= mask << 16;
+            mask ^= mask << 32;
+            return mask;
+        }
+
+        // Works out which bits of the block the parser needs to see and adds
+        // their offsets to :param found:. Quotes are always structural since the
+        // parser has to check every one of them, anything else only is when it
+        // is outside of a quoted entry.
+        inline void addStructural(const BlockMasks& masks, std::size_t base, std::uint64_t& inQuotes, std::vector<std::size_t>& found) {
+            std::uint64_t quoted = prefixXor(masks.quotes) ^ inQuotes;
+            // Carry whether the block ended inside of a quote to the next one.
+            inQuotes = static_cast<std::uint64_t>(0) - (quoted >> 63);
+
+            std::uint64_t structural = masks.quotes | (masks.others & ~quoted);
+            while (structural) {
+                found.push_back(base + countTrailingZeros(structural));
+                structural &= structural - 1;
+            }
+        }
+
+        typedef BlockMasks (*BlockKernel)(const char* block, char sep);
+
+        BlockMasks scalarBlock(const char* block, char sep) {
+            BlockMasks masks = {0, 0};
+            for (std::size_t i = 0; i < BLOCK_SIZE; i++) {
+                const char character = block[i];
+                if (character == '"') {
+                    masks.quotes |= static_cast<std::uint64_t>(1) << i;
+                }
+                else if (character == sep || character == '\r' || character == '\n') {
+                    masks.others |= static_cast<std::uint64_t>(1) << i;
+                }
+            }
+            return masks;
+        }
+
+#ifdef CSV_SCAN_X86
+        BlockMasks sse2Block(const char* block, char sep) {
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i separator = _mm_set1_epi8(sep);
+            const __m128i cr = _mm_set1_epi8('\r');
+            const __m128i lf = _mm_set1_epi8('\n');
+
+            BlockMasks masks = {0, 0};
+            for (std::size_t i = 0; i < BLOCK_SIZE; i += 16) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+                const __m128i others = _mm_or_si128(_mm_cmpeq_epi8(bytes, separator), _mm_or_si128(_mm_cmpeq_epi8(bytes, cr), _mm_cmpeq_epi8(bytes, lf)));
+                masks.quotes |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote)))) << i;
+                masks.others |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(others))) << i;
+            }
+            return masks;
+        }
+
+        CSV_TARGET_AVX2 BlockMasks avx2Block(const char* block, char sep) {
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i separator = _mm256_set1_epi8(sep);
+            const __m256i cr = _mm256_set1_epi8('\r');
+            const __m256i lf = _mm256_set1_epi8('\n');
+
+            BlockMasks masks = {0, 0};
+            for (std::size_t i = 0; i < BLOCK_SIZE; i += 32) {
+                const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+                const __m256i others = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, separator), _mm256_or_si256(_mm256_cmpeq_epi8(bytes, cr), _mm256_cmpeq_epi8(bytes, lf)));
+                masks.quotes |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quote)))) << i;
+                masks.others |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(others))) << i;
+            }
+            return masks;
+        }
+
+        bool cpuHasAVX2() {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            // The OS has to save the AVX registers for us as well.
+            __cpuid(info, 1);
+            if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6) {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        ScanKernel bestScanKernel() {
+#ifdef CSV_SCAN_X86
+            return cpuHasAVX2() ? ScanKernel::AVX2 : ScanKernel::SSE2;
+#else
+            return ScanKernel::Scalar;
+#endif
+        }
+
+        ScanKernel& currentKernel() {
+            static ScanKernel kernel = bestScanKernel();
+            return kernel;
+        }
+
+        BlockKernel blockKernel(ScanKernel kernel) {
+            switch (kernel) {
+#ifdef CSV_SCAN_X86
+            case ScanKernel::AVX2:
+                return avx2Block;
+            case ScanKernel::SSE2:
+                return sse2Block;
+#endif
+            default:
+                return scalarBlock;
+            }
+        }
+    }
+
+    // Returns the kernel the scanner is using.
+    ScanKernel scanKernel() {
+        return currentKernel();
+    }
+
+    // Forces the scanner to use :param kernel:, mostly so they can be compared
+    // against each other. Kernels the processor can't run are ignored.
+    void setScanKernel(ScanKernel kernel) {
+        if (scanKernelSupported(kernel)) {
+            currentKernel() = kernel;
+        }
+    }
+
+    bool scanKernelSupported(ScanKernel kernel) {
+        switch (kernel) {
+#ifdef CSV_SCAN_X86
+        case ScanKernel::AVX2:
+            return cpuHasAVX2();
+        case ScanKernel::SSE2:
+            return true;
+#endif
+        case ScanKernel::Scalar:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    const char* scanKernelName(ScanKernel kernel) {
+        switch (kernel) {
+        case ScanKernel::AVX2:
+            return "AVX2";
+        case ScanKernel::SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+        }
+    }
+
+    StructuralScanner::StructuralScanner(std::string_view input, char sep) : input(input), sep(sep), scanned(0), inQuotes(0), window(FIRST_WINDOW), index(0) {}
+
+    std::size_t StructuralScanner::next() {
+        while (index == found.size()) {
+            if (scanned == input.size()) {
+                return input.size();
+            }
+            refill();
+        }
+        return found[index++];
+    }
+
+    // Scans the next window of the input, replacing the offsets that have
+    // already been handed out.
+    void StructuralScanner::refill() {
+        const BlockKernel kernel = blockKernel(currentKernel());
+        const std::size_t stop = (input.size() - scanned > window) ? scanned + window : input.size();
+
+        found.clear();
+        index = 0;
+
+        for (; scanned + BLOCK_SIZE <= stop; scanned += BLOCK_SIZE) {
+            addStructural(kernel(input.data() + scanned, sep), scanned, inQuotes, found);
+        }
+
+        // The last few bytes of the input don't fill a whole block, so copy them
+        // somewhere that does. The padding is zeros, which are never structural.
+        if (scanned < stop) {
+            char block[BLOCK_SIZE] = {};
+            std::memcpy(block, input.data() + scanned, stop - scanned);
+            addStructural(kernel(block, sep), scanned, inQuotes, found);
+            scanned = stop;
+        }
+
+        if (window < MAX_WINDOW) {
+            window *= 2;
+        }
+    }
+}
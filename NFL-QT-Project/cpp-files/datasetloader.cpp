@@ -0,0 +1,115 @@
+#include "datasetloader.h"
+#include <QtConcurrent>
+
+
+DatasetLoader::DatasetLoader(QObject *parent) : QObject(parent), cancelled(false)
+{
+    this->loading = false;
+    this->makeSnapshot = false;
+    QObject::connect(&this->watcher, SIGNAL(finished()), this, SLOT(readFinished()));
+}
+
+
+// Stops any file that is still being read, since the thread reading it uses
+// this loader, and lets any snapshot that is being written finish.
+DatasetLoader::~DatasetLoader()
+{
+    this->cancel();
+    this->watcher.waitForFinished();
+    this->snapshotWriter.waitForFinished();
+}
+
+
+/*
+ * Starts reading the file at :param path: on another thread, from its
+ * snapshot if :param snapshot: is true and it has an up to date one. Returns
+ * false without doing anything if a file is already being read.
+ */
+bool DatasetLoader::load(const QString& path, bool snapshot)
+{
+    if (this->isLoading())
+    {
+        return false;
+    }
+
+    this->loading = true;
+    this->cancelled = false;
+    this->makeSnapshot = false;
+    emit progressChanged(0);
+
+    this->watcher.setFuture(QtConcurrent::run([this, path, snapshot]()
+    {
+        LoadResult result;
+        result.path = path;
+        int lastPercent = 0;
+
+        if (snapshot)
+        {
+            if (readSnapshot(path, result.records, &result.orders))
+            {
+                return result;
+            }
+
+            // Look at the file before reading it, so a snapshot made from it
+            // can't be taken for one of a newer version of the file.
+            this->makeSnapshot = readSnapshotSource(path, this->source);
+        }
+
+        readRowsFromFile(path.toStdString(), result.records, &result.error, [this, &lastPercent](std::size_t done, std::size_t total)
+        {
+            // Only send a signal when the percentage changes. It is sent from
+            // this thread, so it gets queued for the loader's thread.
+            const int percent = total == 0 ? 100 : static_cast<int>(done * 100 / total);
+            if (percent != lastPercent)
+            {
+                lastPercent = percent;
+                emit this->progressChanged(percent);
+            }
+            return !this->cancelled;
+        });
+        return result;
+    }));
+    return true;
+}
+
+
+// Stops reading the file. finished is still sent, with a Cancelled error.
+void DatasetLoader::cancel()
+{
+    this->cancelled = true;
+}
+
+
+bool DatasetLoader::isLoading() const
+{
+    return this->loading;
+}
+
+
+/*
+ * Makes a snapshot of the file that was just read if it was asked for, as long
+ * as the whole file was read and another snapshot isn't still being written.
+ */
+void DatasetLoader::readFinished()
+{
+    const LoadResult result = this->watcher.result();
+    if (this->makeSnapshot && result.error.kind == LoadError::None && !this->snapshotWriter.isRunning())
+    {
+        const SnapshotSource source = this->source;
+        this->snapshotWriter = QtConcurrent::run([result, source]()
+        {
+            writeSnapshot(result.path, source, result.records);
+        });
+    }
+    this->makeSnapshot = false;
+
+    this->loading = false;
+    emit finished();
+}
+
+
+// Gets what was read from the last file. Only valid after finished is sent.
+LoadResult DatasetLoader::result() const
+{
+    return this->watcher.result();
+}
@@ -0,0 +1,117 @@
+#include "dictionary.h"
+#include <QMutexLocker>
+
+
+Dictionary::Dictionary() : count(0)
+{
+    for (int i = 0; i < BLOCK_COUNT; i++)
+    {
+        this->blocks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+
+Dictionary::~Dictionary()
+{
+    for (int i = 0; i < BLOCK_COUNT; i++)
+    {
+        delete[] this->blocks[i].load(std::memory_order_relaxed);
+    }
+}
+
+
+/*
+ * Gets the code for :param text:, giving it a new one if it hasn't been seen
+ * before. Returns false if it is new and the dictionary is already full.
+ */
+bool Dictionary::encode(std::string_view text, DictionaryCode& out)
+{
+    QMutexLocker locker(&this->lock);
+
+    // Look the text up without copying it, it only gets copied if it is new.
+    auto found = this->codes.constFind(QByteArray::fromRawData(text.data(), static_cast<int>(text.size())));
+    if (found != this->codes.constEnd())
+    {
+        out = found.value();
+        return true;
+    }
+
+    return this->insert(QByteArray(text.data(), static_cast<int>(text.size())), out);
+}
+
+
+bool Dictionary::encode(const QString& text, DictionaryCode& out)
+{
+    QMutexLocker locker(&this->lock);
+
+    QByteArray key = text.toUtf8();
+    auto found = this->codes.constFind(key);
+    if (found != this->codes.constEnd())
+    {
+        out = found.value();
+        return true;
+    }
+
+    return this->insert(key, out);
+}
+
+
+/*
+ * Gets the code for :param text: without adding it. Returns false if the text
+ * has never been seen, in which case no row can have it either.
+ */
+bool Dictionary::find(const QString& text, DictionaryCode& out) const
+{
+    QMutexLocker locker(&this->lock);
+
+    auto found = this->codes.constFind(text.toUtf8());
+    if (found == this->codes.constEnd())
+    {
+        return false;
+    }
+    out = found.value();
+    return true;
+}
+
+
+/*
+ * Gets the text for a code that came from encode.
+ */
+const QString& Dictionary::text(DictionaryCode code) const
+{
+    return this->blocks[code / BLOCK_SIZE].load(std::memory_order_acquire)[code % BLOCK_SIZE];
+}
+
+
+// The number of different values seen, every code is less than this.
+int Dictionary::size() const
+{
+    return this->count.load(std::memory_order_acquire);
+}
+
+
+// Adds a new value. The lock has to be held already.
+bool Dictionary::insert(const QByteArray& key, DictionaryCode& out)
+{
+    const int code = this->count.load(std::memory_order_relaxed);
+    if (code >= MAX_SIZE)
+    {
+        return false;
+    }
+
+    QString* block = this->blocks[code / BLOCK_SIZE].load(std::memory_order_relaxed);
+    if (!block)
+    {
+        block = new QString[BLOCK_SIZE];
+        this->blocks[code / BLOCK_SIZE].store(block, std::memory_order_release);
+    }
+    block[code % BLOCK_SIZE] = QString::fromUtf8(key);
+
+    this->codes.insert(key, static_cast<DictionaryCode>(code));
+    // Only count it once the text is in place so nobody can see the code
+    // before its text.
+    this->count.store(code + 1, std::memory_order_release);
+
+    out = static_cast<DictionaryCode>(code);
+    return true;
+}
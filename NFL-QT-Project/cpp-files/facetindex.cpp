@@ -0,0 +1,69 @@
+#include "facetindex.h"
+#include <algorithm>
+
+
+bool isFacetColumn(Column column)
+{
+    return std::find(std::begin(FACET_COLUMNS), std::end(FACET_COLUMNS), column) != std::end(FACET_COLUMNS);
+}
+
+
+// Adds :param record:, which is :param row: in the table's list of rows.
+void FacetIndex::add(const TeamRecord& record, int row)
+{
+    for (auto column = std::begin(FACET_COLUMNS); column != std::end(FACET_COLUMNS); column++)
+    {
+        QVector<int>& rows = this->index[static_cast<int>(*column)][record.text(*column)];
+
+        // Rows are nearly always added to the end of the table.
+        if (rows.isEmpty() || rows.back() < row)
+        {
+            rows.push_back(row);
+        }
+        else
+        {
+            rows.insert(std::lower_bound(rows.begin(), rows.end(), row) - rows.begin(), row);
+        }
+    }
+}
+
+
+void FacetIndex::clear()
+{
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        this->index[column].clear();
+    }
+}
+
+
+/*
+ * Gets every value of :param column: that at least one of the rows before
+ * :param rowLimit: has, in order.
+ */
+void FacetIndex::values(Column column, int rowLimit, QVector<QString>& out) const
+{
+    const QMap<QString, QVector<int>>& values = this->index[static_cast<int>(column)];
+
+    out.clear();
+    out.reserve(values.size());
+
+    // The rows are in order, so only the first one needs checking.
+    for (auto it = values.cbegin(); it != values.cend(); it++)
+    {
+        if (it.value().front() < rowLimit)
+        {
+            out.push_back(it.key());
+        }
+    }
+}
+
+
+// Gets the rows that have :param value: in :param column:, in order, or nullptr if none do.
+const QVector<int>* FacetIndex::rows(Column column, const QString& value) const
+{
+    const QMap<QString, QVector<int>>& values = this->index[static_cast<int>(column)];
+    auto found = values.constFind(value);
+
+    return found == values.cend() ? nullptr : &found.value();
+}
@@ -0,0 +1,825 @@
+#include "filterexpression.h"
+#include "parallel.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+
+namespace
+{
+    // How many rows are checked together. Each batch keeps a bit for each of
+    // its rows, so this many bits fit on the stack for every level of the
+    // expression.
+    const int BATCH_ROWS = 4096;
+    const int BATCH_WORDS = BATCH_ROWS / 64;
+
+    // How deep brackets and NOTs can go, which keeps the batches on the stack.
+    const int MAX_DEPTH = 64;
+
+    // Where a text or encoded column is in a TeamRecord, or nullptr if
+    // :param column: isn't one.
+    const QString TeamRecord::* textMember(Column column)
+    {
+        return visitColumn(column, [](auto constant) -> const QString TeamRecord::*
+        {
+            if constexpr (ColumnTraits<decltype(constant)::value>::kind == ColumnKind::Text)
+            {
+                return ColumnTraits<decltype(constant)::value>::member;
+            }
+            return nullptr;
+        });
+    }
+
+    DictionaryCode TeamRecord::* encodedMember(Column column)
+    {
+        return visitColumn(column, [](auto constant) -> DictionaryCode TeamRecord::*
+        {
+            if constexpr (ColumnTraits<decltype(constant)::value>::encoded)
+            {
+                return ColumnTraits<decltype(constant)::value>::member;
+            }
+            return nullptr;
+        });
+    }
+
+    /*
+     * Sets the bit in :param out: of each row selected in :param mask: that
+     * :param test: passes, and clears the rest. Only the selected rows are
+     * looked at, and a word of 64 rows that has none selected is skipped.
+     */
+    template <typename Test>
+    void scan(const TeamRecord* const* rows, const quint64* mask, quint64* out, Test test)
+    {
+        for (int word = 0; word < BATCH_WORDS; word++)
+        {
+            quint64 selected = mask[word];
+            quint64 passed = 0;
+            while (selected)
+            {
+                const int bit = qCountTrailingZeroBits(selected);
+                if (test(*rows[word * 64 + bit]))
+                {
+                    passed |= static_cast<quint64>(1) << bit;
+                }
+                selected &= selected - 1;
+            }
+            out[word] = passed;
+        }
+    }
+
+    bool noneSelected(const quint64* bits)
+    {
+        for (int word = 0; word < BATCH_WORDS; word++)
+        {
+            if (bits[word])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+// The tree the text is parsed into, before it is compiled.
+struct FilterExpression::Node
+{
+    Instruction::Kind kind;
+    // Both sides of And and Or, or just the left for Not.
+    std::unique_ptr<Node> left;
+    std::unique_ptr<Node> right;
+
+    // The column, operator and value of a Compare as they were typed, and
+    // where the column name starts in the text.
+    QString column;
+    int position;
+    Operator op;
+    QString value;
+    bool number;
+};
+
+
+// Turns the text of a filter into a tree of Nodes, or an error saying where it went wrong.
+class FilterExpression::Parser
+{
+public:
+    explicit Parser(const QString& text);
+
+    std::unique_ptr<Node> parse(QString* error);
+private:
+    struct Token
+    {
+        enum Type
+        {
+            Word,
+            Number,
+            Text,
+            Symbol,
+            End
+        };
+
+        Type type;
+        QString text;
+        // Where the token starts in the text, counting from 1.
+        int position;
+    };
+
+    bool tokenize();
+    std::unique_ptr<Node> parseOr(int depth);
+    std::unique_ptr<Node> parseAnd(int depth);
+    std::unique_ptr<Node> parseNot(int depth);
+    std::unique_ptr<Node> parseComparison(int depth);
+    bool isKeyword(const char* keyword) const;
+    std::unique_ptr<Node> fail(const QString& message);
+
+    const QString& text;
+    QVector<Token> tokens;
+    int next;
+    QString error;
+};
+
+
+FilterExpression::Parser::Parser(const QString& text) : text(text)
+{
+    this->next = 0;
+}
+
+
+std::unique_ptr<FilterExpression::Node> FilterExpression::Parser::parse(QString* error)
+{
+    std::unique_ptr<Node> root;
+    if (this->tokenize())
+    {
+        root = this->parseOr(0);
+        if (root && this->tokens[this->next].type != Token::End)
+        {
+            root = this->fail("Expected AND, OR or the end of the filter");
+        }
+    }
+
+    if (!root && error)
+    {
+        *error = this->error;
+    }
+    return root;
+}
+
+
+bool FilterExpression::Parser::tokenize()
+{
+    const int length = this->text.size();
+    int i = 0;
+
+    while (true)
+    {
+        while (i < length && this->text[i].isSpace())
+        {
+            i++;
+        }
+        if (i == length)
+        {
+            break;
+        }
+
+        const QChar letter = this->text[i];
+        const int start = i;
+
+        if (letter.isLetter() || letter == '_')
+        {
+            while (i < length && (this->text[i].isLetterOrNumber() || this->text[i] == '_'))
+            {
+                i++;
+            }
+            this->tokens.append(Token{Token::Word, this->text.mid(start, i - start), start + 1});
+        }
+        // Numbers can have thousands separators, like the capacities do.
+        else if (letter.isDigit())
+        {
+            while (i < length && (this->text[i].isDigit() || this->text[i] == ','))
+            {
+                i++;
+            }
+            this->tokens.append(Token{Token::Number, this->text.mid(start, i - start), start + 1});
+        }
+        else if (letter == '"' || letter == '\'')
+        {
+            i++;
+            while (i < length && this->text[i] != letter)
+            {
+                i++;
+            }
+            if (i == length)
+            {
+                this->error = QString("The text starting at character %1 is missing its closing quote").arg(start + 1);
+                return false;
+            }
+            this->tokens.append(Token{Token::Text, this->text.mid(start + 1, i - start - 1), start + 1});
+            i++;
+        }
+        else
+        {
+            static const char* const symbols[] = {"==", "!=", "<>", "<=", ">=", "=", "<", ">", "(", ")"};
+            const char* found = nullptr;
+            for (auto symbol = std::begin(symbols); symbol != std::end(symbols) && !found; symbol++)
+            {
+                if (this->text.mid(i, static_cast<int>(std::strlen(*symbol))) == *symbol)
+                {
+                    found = *symbol;
+                }
+            }
+            if (!found)
+            {
+                this->error = QString("Unexpected \"%1\" at character %2").arg(QString(letter)).arg(start + 1);
+                return false;
+            }
+            i += static_cast<int>(std::strlen(found));
+            this->tokens.append(Token{Token::Symbol, found, start + 1});
+        }
+    }
+
+    this->tokens.append(Token{Token::End, QString(), length + 1});
+    return true;
+}
+
+
+// AND goes before OR, so an OR joins the ANDs on either side of it.
+std::unique_ptr<FilterExpression::Node> FilterExpression::Parser::parseOr(int depth)
+{
+    std::unique_ptr<Node> left = this->parseAnd(depth);
+    while (left && this->isKeyword("or"))
+    {
+        this->next++;
+        std::unique_ptr<Node> right = this->parseAnd(depth);
+        if (!right)
+        {
+            return nullptr;
+        }
+
+        std::unique_ptr<Node> join(new Node());
+        join->kind = Instruction::Or;
+        join->left = std::move(left);
+        join->right = std::move(right);
+        left = std::move(join);
+    }
+    return left;
+}
+
+
+std::unique_ptr<FilterExpression::Node> FilterExpression::Parser::parseAnd(int depth)
+{
+    std::unique_ptr<Node> left = this->parseNot(depth);
+    while (left && this->isKeyword("and"))
+    {
+        this->next++;
+        std::unique_ptr<Node> right = this->parseNot(depth);
+        if (!right)
+        {
+            return nullptr;
+        }
+
+        std::unique_ptr<Node> join(new Node());
+        join->kind = Instruction::And;
+        join->left = std::move(left);
+        join->right = std::move(right);
+        left = std::move(join);
+    }
+    return left;
+}
+
+
+std::unique_ptr<FilterExpression::Node> FilterExpression::Parser::parseNot(int depth)
+{
+    if (depth > MAX_DEPTH)
+    {
+        return this->fail("The filter has too many brackets or NOTs inside each other");
+    }
+
+    if (this->isKeyword("not"))
+    {
+        this->next++;
+        std::unique_ptr<Node> child = this->parseNot(depth + 1);
+        if (!child)
+        {
+            return nullptr;
+        }
+
+        std::unique_ptr<Node> flip(new Node());
+        flip->kind = Instruction::Not;
+        flip->left = std::move(child);
+        return flip;
+    }
+
+    const Token& token = this->tokens[this->next];
+    if (token.type == Token::Symbol && token.text == "(")
+    {
+        this->next++;
+        std::unique_ptr<Node> inside = this->parseOr(depth + 1);
+        if (!inside)
+        {
+            return nullptr;
+        }
+        if (this->tokens[this->next].type != Token::Symbol || this->tokens[this->next].text != ")")
+        {
+            return this->fail("Expected a closing bracket");
+        }
+        this->next++;
+        return inside;
+    }
+
+    return this->parseComparison(depth);
+}
+
+
+std::unique_ptr<FilterExpression::Node> FilterExpression::Parser::parseComparison(int)
+{
+    const Token& column = this->tokens[this->next];
+    if (column.type != Token::Word || this->isKeyword("and") || this->isKeyword("or"))
+    {
+        return this->fail("Expected a column name");
+    }
+    this->next++;
+
+    static const struct
+    {
+        const char* symbol;
+        Operator op;
+    } operators[] = {
+        {"=", Operator::Equal},
+        {"==", Operator::Equal},
+        {"!=", Operator::NotEqual},
+        {"<>", Operator::NotEqual},
+        {"<", Operator::Less},
+        {"<=", Operator::LessOrEqual},
+        {">", Operator::Greater},
+        {">=", Operator::GreaterOrEqual}
+    };
+
+    const Token& symbol = this->tokens[this->next];
+    auto op = std::find_if(std::begin(operators), std::end(operators), [&symbol](const auto& candidate) { return symbol.type == Token::Symbol && symbol.text == candidate.symbol; });
+    if (op == std::end(operators))
+    {
+        return this->fail(QString("Expected =, !=, <, <=, > or >= after \"%1\"").arg(column.text));
+    }
+    this->next++;
+
+    const Token& value = this->tokens[this->next];
+    if (value.type != Token::Number && value.type != Token::Text)
+    {
+        return this->fail("Expected a number or some text in quotes");
+    }
+    this->next++;
+
+    std::unique_ptr<Node> comparison(new Node());
+    comparison->kind = Instruction::Compare;
+    comparison->column = column.text;
+    comparison->position = column.position;
+    comparison->op = op->op;
+    comparison->value = value.text;
+    comparison->number = value.type == Token::Number;
+    return comparison;
+}
+
+
+bool FilterExpression::Parser::isKeyword(const char* keyword) const
+{
+    const Token& token = this->tokens[this->next];
+    return token.type == Token::Word && token.text.compare(keyword, Qt::CaseInsensitive) == 0;
+}
+
+
+// Notes what was wrong with the token that is next, and returns no tree.
+std::unique_ptr<FilterExpression::Node> FilterExpression::Parser::fail(const QString& message)
+{
+    const Token& token = this->tokens[this->next];
+    if (token.type == Token::End)
+    {
+        this->error = message + " at the end of the filter";
+    }
+    else
+    {
+        this->error = QString("%1 at character %2").arg(message).arg(token.position);
+    }
+    return nullptr;
+}
+
+
+FilterExpression::FilterExpression()
+{
+    this->root = -1;
+}
+
+
+/*
+ * Parses and compiles :param text:. An empty filter lets every row through. If
+ * the text isn't a valid filter, this filter is left how it was and
+ * :param error: (if given) says what is wrong with it.
+ */
+bool FilterExpression::compile(const QString& text, QString* error)
+{
+    if (text.trimmed().isEmpty())
+    {
+        this->source.clear();
+        this->program.clear();
+        this->root = -1;
+        return true;
+    }
+
+    Parser parser(text);
+    std::unique_ptr<Node> tree = parser.parse(error);
+    if (!tree)
+    {
+        return false;
+    }
+
+    FilterExpression compiled;
+    compiled.root = compiled.compileNode(*tree, error);
+    if (compiled.root < 0)
+    {
+        return false;
+    }
+
+    compiled.source = text.trimmed();
+    *this = compiled;
+    return true;
+}
+
+
+bool FilterExpression::isEmpty() const
+{
+    return this->root < 0;
+}
+
+
+const QString& FilterExpression::text() const
+{
+    return this->source;
+}
+
+
+/*
+ * Writes out the compiled program, so filters that only differ in spacing,
+ * the case of the keywords and text, how numbers and operators were written
+ * or extra brackets have the same key. An empty filter's key is empty.
+ */
+QString FilterExpression::key() const
+{
+    QString out;
+    if (this->root >= 0)
+    {
+        this->writeKey(this->root, out);
+    }
+    return out;
+}
+
+
+void FilterExpression::writeKey(int instruction, QString& out) const
+{
+    const Instruction& step = this->program[instruction];
+    if (step.kind == Instruction::Compare)
+    {
+        out += QString("%1 %2 ").arg(static_cast<int>(step.column)).arg(static_cast<int>(step.op));
+        if (isNumericColumn(step.column))
+        {
+            out += QString::number(step.number);
+        }
+        else
+        {
+            // The text can have any quote in it, so its length says where it ends.
+            const QString text = step.text.toCaseFolded();
+            out += QString("%1:%2").arg(text.size()).arg(text);
+        }
+        return;
+    }
+
+    out += step.kind == Instruction::And ? "and(" : step.kind == Instruction::Or ? "or(" : "not(";
+    for (int i = 0; i < step.children.size(); i++)
+    {
+        if (i > 0)
+        {
+            out += ',';
+        }
+        this->writeKey(step.children[i], out);
+    }
+    out += ')';
+}
+
+
+/*
+ * Adds :param node: and everything under it to the program, returning where it
+ * was put or -1 if one of its comparisons can't be done. A run of ANDs (or of
+ * ORs) becomes one instruction, so the selected rows carry from one of its
+ * parts to the next.
+ */
+int FilterExpression::compileNode(const Node& node, QString* error)
+{
+    Instruction instruction;
+    instruction.kind = node.kind;
+
+    if (node.kind == Instruction::Compare)
+    {
+        if (!findColumn(node.column, instruction.column))
+        {
+            if (error)
+            {
+                *error = QString("There is no column called \"%1\" (at character %2)").arg(node.column).arg(node.position);
+            }
+            return -1;
+        }
+        instruction.op = node.op;
+        instruction.text = node.value;
+        instruction.number = 0;
+
+        if (isNumericColumn(instruction.column))
+        {
+            if (!node.number)
+            {
+                if (error)
+                {
+                    *error = QString("\"%1\" has to be compared with a number (at character %2)").arg(node.column).arg(node.position);
+                }
+                return -1;
+            }
+
+            quint64 number = 0;
+            for (int i = 0; i < node.value.size() && number <= 0xFFFFFFFFu; i++)
+            {
+                if (node.value[i] != ',')
+                {
+                    number = number * 10 + node.value[i].digitValue();
+                }
+            }
+            if (number > 0xFFFFFFFFu)
+            {
+                if (error)
+                {
+                    *error = QString("%1 is too big to compare \"%2\" with (at character %3)").arg(node.value).arg(node.column).arg(node.position);
+                }
+                return -1;
+            }
+            instruction.number = static_cast<quint32>(number);
+        }
+    }
+    else if (node.kind == Instruction::Not)
+    {
+        const int child = this->compileNode(*node.left, error);
+        if (child < 0)
+        {
+            return -1;
+        }
+        instruction.children.append(child);
+    }
+    else
+    {
+        // Go down the chain of the same kind of join, keeping the parts in
+        // the order they were typed.
+        std::vector<const Node*> parts;
+        std::vector<const Node*> pending(1, &node);
+        while (!pending.empty())
+        {
+            const Node* part = pending.back();
+            pending.pop_back();
+            if (part->kind == node.kind)
+            {
+                pending.push_back(part->right.get());
+                pending.push_back(part->left.get());
+            }
+            else
+            {
+                parts.push_back(part);
+            }
+        }
+
+        for (auto part = parts.cbegin(); part != parts.cend(); part++)
+        {
+            const int child = this->compileNode(**part, error);
+            if (child < 0)
+            {
+                return -1;
+            }
+            instruction.children.append(child);
+        }
+    }
+
+    this->program.append(instruction);
+    return this->program.size() - 1;
+}
+
+
+/*
+ * Works out whether each code of the encoded columns being compared passes.
+ * Codes can be added to a dictionary at any time, so this only has to look at
+ * the ones that were added since the last time.
+ */
+void FilterExpression::prepare()
+{
+    for (auto instruction = this->program.begin(); instruction != this->program.end(); instruction++)
+    {
+        if (instruction->kind != Instruction::Compare || !isEncodedColumn(instruction->column))
+        {
+            continue;
+        }
+
+        const Dictionary& dictionary = columnDictionary(instruction->column);
+        for (int code = static_cast<int>(instruction->codes.size()); code < dictionary.size(); code++)
+        {
+            instruction->codes.push_back(compareText(dictionary.text(static_cast<DictionaryCode>(code)), instruction->op, instruction->text));
+        }
+    }
+}
+
+
+/*
+ * Checks :param rows: from :param first: to the end, setting their bits in
+ * :param bits: (which is made big enough for all of them) if they pass and
+ * clearing them if they don't. The bits of the rows before :param first: are
+ * left alone, so rows added to the end only need to have themselves checked.
+ */
+void FilterExpression::evaluate(const QVector<const TeamRecord*>& rows, int first, std::vector<quint64>& bits)
+{
+    const int count = rows.size();
+    bits.resize((count + 63) / 64, 0);
+    if (this->root < 0 || first >= count)
+    {
+        return;
+    }
+
+    this->prepare();
+
+    const int firstBatch = first / BATCH_ROWS;
+    const int batches = (count + BATCH_ROWS - 1) / BATCH_ROWS - firstBatch;
+
+    // Every batch starts on a word of bits, so batches never write to the
+    // same word and can run at the same time.
+    auto task = [&](std::size_t batch)
+    {
+        const int start = (firstBatch + static_cast<int>(batch)) * BATCH_ROWS;
+        const int end = std::min(start + BATCH_ROWS, count);
+
+        quint64 mask[BATCH_WORDS];
+        quint64 passed[BATCH_WORDS];
+        for (int word = 0; word < BATCH_WORDS; word++)
+        {
+            const int low = std::max(start + word * 64, first);
+            const int high = std::min(start + word * 64 + 64, end);
+            mask[word] = 0;
+            if (low < high)
+            {
+                const quint64 below = high - low == 64 ? ~static_cast<quint64>(0) : (static_cast<quint64>(1) << (high - low)) - 1;
+                mask[word] = below << (low - start - word * 64);
+            }
+        }
+
+        this->run(this->root, rows.constData() + start, mask, passed);
+
+        for (int word = 0; word < BATCH_WORDS && start + word * 64 < end; word++)
+        {
+            quint64& out = bits[start / 64 + word];
+            out = (out & ~mask[word]) | passed[word];
+        }
+    };
+
+    if (count - first < PARALLEL_MIN_ROWS)
+    {
+        for (int batch = 0; batch < batches; batch++)
+        {
+            task(batch);
+        }
+    }
+    else
+    {
+        runTasks(batches, defaultThreadCount(), task);
+    }
+}
+
+
+/*
+ * Runs :param instruction: over a batch of :param rows:, setting the bit in
+ * :param out: of each row selected in :param mask: that passes. An AND hands the
+ * rows each part passes on to the next part, and an OR only hands each part the
+ * rows that none of the parts before it passed.
+ */
+void FilterExpression::run(int instruction, const TeamRecord* const* rows, const quint64* mask, quint64* out) const
+{
+    const Instruction& step = this->program[instruction];
+    quint64 selected[BATCH_WORDS];
+    quint64 passed[BATCH_WORDS];
+
+    switch (step.kind)
+    {
+    case Instruction::Compare:
+        this->compare(step, rows, mask, out);
+        break;
+
+    case Instruction::And:
+        std::copy(mask, mask + BATCH_WORDS, selected);
+        for (auto child = step.children.cbegin(); child != step.children.cend() && !noneSelected(selected); child++)
+        {
+            this->run(*child, rows, selected, passed);
+            std::copy(passed, passed + BATCH_WORDS, selected);
+        }
+        std::copy(selected, selected + BATCH_WORDS, out);
+        break;
+
+    case Instruction::Or:
+        std::copy(mask, mask + BATCH_WORDS, selected);
+        std::fill(out, out + BATCH_WORDS, 0);
+        for (auto child = step.children.cbegin(); child != step.children.cend() && !noneSelected(selected); child++)
+        {
+            this->run(*child, rows, selected, passed);
+            for (int word = 0; word < BATCH_WORDS; word++)
+            {
+                out[word] |= passed[word];
+                selected[word] &= ~passed[word];
+            }
+        }
+        break;
+
+    case Instruction::Not:
+        this->run(step.children.front(), rows, mask, passed);
+        for (int word = 0; word < BATCH_WORDS; word++)
+        {
+            out[word] = mask[word] & ~passed[word];
+        }
+        break;
+    }
+}
+
+
+// Runs one comparison over a batch of rows. The column and operator are picked once for the whole batch.
+void FilterExpression::compare(const Instruction& instruction, const TeamRecord* const* rows, const quint64* mask, quint64* out) const
+{
+    if (isEncodedColumn(instruction.column))
+    {
+        DictionaryCode TeamRecord::* const member = encodedMember(instruction.column);
+        const std::vector<char>& codes = instruction.codes;
+        scan(rows, mask, out, [member, &codes](const TeamRecord& record)
+        {
+            const DictionaryCode code = record.*member;
+            return code < codes.size() && codes[code];
+        });
+        return;
+    }
+
+    if (!isNumericColumn(instruction.column))
+    {
+        const QString TeamRecord::* const member = textMember(instruction.column);
+        scan(rows, mask, out, [member, &instruction](const TeamRecord& record)
+        {
+            return compareText(record.*member, instruction.op, instruction.text);
+        });
+        return;
+    }
+
+    visitColumn(instruction.column, [&](auto constant)
+    {
+        constexpr Column column = decltype(constant)::value;
+        if constexpr (ColumnTraits<column>::numeric)
+        {
+            const quint32 number = instruction.number;
+            switch (instruction.op)
+            {
+            case Operator::Equal:
+                scan(rows, mask, out, [number](const TeamRecord& record) { return get<column>(record) == number; });
+                break;
+            case Operator::NotEqual:
+                scan(rows, mask, out, [number](const TeamRecord& record) { return get<column>(record) != number; });
+                break;
+            case Operator::Less:
+                scan(rows, mask, out, [number](const TeamRecord& record) { return get<column>(record) < number; });
+                break;
+            case Operator::LessOrEqual:
+                scan(rows, mask, out, [number](const TeamRecord& record) { return get<column>(record) <= number; });
+                break;
+            case Operator::Greater:
+                scan(rows, mask, out, [number](const TeamRecord& record) { return get<column>(record) > number; });
+                break;
+            case Operator::GreaterOrEqual:
+                scan(rows, mask, out, [number](const TeamRecord& record) { return get<column>(record) >= number; });
+                break;
+            }
+        }
+    });
+}
+
+
+bool FilterExpression::compareText(const QString& value, Operator op, const QString& text)
+{
+    // Text of different lengths can't be the same, whatever the case.
+    if ((op == Operator::Equal || op == Operator::NotEqual) && value.size() != text.size())
+    {
+        return op == Operator::NotEqual;
+    }
+
+    const int order = QString::compare(value, text, Qt::CaseInsensitive);
+    switch (op)
+    {
+    case Operator::Equal: return order == 0;
+    case Operator::NotEqual: return order != 0;
+    case Operator::Less: return order < 0;
+    case Operator::LessOrEqual: return order <= 0;
+    case Operator::Greater: return order > 0;
+    default: return order >= 0;
+    }
+}
@@ -0,0 +1,158 @@
+#include "groupsummary.h"
+#include <algorithm>
+
+
+double GroupTotals::averageCapacity() const
+{
+    return this->stadiums > 0 ? static_cast<double>(this->totalCapacity) / this->stadiums : 0;
+}
+
+
+/*
+ * Groups by :param first:, and then by :param second: if it isn't -1. Nothing
+ * is added until update is called.
+ */
+GroupSummary::GroupSummary(Column first, int second)
+{
+    this->first = first;
+    this->second = second;
+    this->rowCount = 0;
+}
+
+
+/*
+ * Adds the rows that were added to the end of :param rows: since the last time.
+ * The rows that were there before can't have changed, so clear has to be
+ * called first if they did.
+ */
+void GroupSummary::update(const QVector<const TeamRecord*>& rows)
+{
+    for (; this->rowCount < rows.size(); this->rowCount++)
+    {
+        this->add(*rows[this->rowCount]);
+    }
+}
+
+
+void GroupSummary::clear()
+{
+    this->groupsByKey.clear();
+    this->textValues[0].clear();
+    this->textValues[1].clear();
+    this->rowCount = 0;
+}
+
+
+// Gets every group, in order of the first column and then the second.
+void GroupSummary::groups(QVector<GroupTotals>& out) const
+{
+    QVector<const Group*> sorted;
+    sorted.reserve(this->groupsByKey.size());
+    for (auto it = this->groupsByKey.cbegin(); it != this->groupsByKey.cend(); it++)
+    {
+        sorted.push_back(&it.value());
+    }
+
+    const bool firstNumeric = isNumericColumn(this->first);
+    const bool secondNumeric = this->second > -1 && isNumericColumn(static_cast<Column>(this->second));
+    std::sort(sorted.begin(), sorted.end(), [firstNumeric, secondNumeric](const Group* a, const Group* b)
+    {
+        if (a->firstValue != b->firstValue || a->totals.first != b->totals.first)
+        {
+            return firstNumeric ? a->firstValue < b->firstValue : a->totals.first < b->totals.first;
+        }
+        return secondNumeric ? a->secondValue < b->secondValue : a->totals.second < b->totals.second;
+    });
+
+    out.clear();
+    out.reserve(sorted.size());
+    for (auto it = sorted.cbegin(); it != sorted.cend(); it++)
+    {
+        out.push_back((*it)->totals);
+    }
+}
+
+
+/*
+ * Gets a number that is the same for every record with the same value of
+ * :param column:, and different for every record with a different one.
+ * :param slot: says which of the columns being grouped by it is.
+ */
+quint32 GroupSummary::valueOf(const TeamRecord& record, Column column, int slot)
+{
+    return visitColumn(column, [this, &record, slot](auto constant) -> quint32
+    {
+        constexpr Column current = decltype(constant)::value;
+
+        // Numbers and codes are already different for every value.
+        if constexpr (ColumnTraits<current>::kind != ColumnKind::Text)
+        {
+            return get<current>(record);
+        }
+        else
+        {
+            QHash<QString, quint32>& values = this->textValues[slot];
+            auto found = values.find(get<current>(record));
+            if (found == values.end())
+            {
+                found = values.insert(get<current>(record), static_cast<quint32>(values.size()));
+            }
+            return found.value();
+        }
+    });
+}
+
+
+void GroupSummary::add(const TeamRecord& record)
+{
+    const quint32 firstValue = this->valueOf(record, this->first, 0);
+    const quint32 secondValue = this->second > -1 ? this->valueOf(record, static_cast<Column>(this->second), 1) : 0;
+    const quint64 key = (static_cast<quint64>(firstValue) << 32) | secondValue;
+
+    auto found = this->groupsByKey.find(key);
+    if (found == this->groupsByKey.end())
+    {
+        Group group;
+        group.firstValue = firstValue;
+        group.secondValue = secondValue;
+        group.totals.first = record.text(this->first);
+        if (this->second > -1)
+        {
+            group.totals.second = record.text(static_cast<Column>(this->second));
+        }
+        group.totals.teams = 0;
+        group.totals.stadiums = 0;
+        group.totals.totalCapacity = 0;
+        group.totals.smallestCapacity = record.seatingCapacity;
+        group.totals.largestCapacity = record.seatingCapacity;
+        group.totals.oldestStadium = record.stadiumName;
+        group.totals.oldestYear = record.yearOpened;
+        group.totals.newestStadium = record.stadiumName;
+        group.totals.newestYear = record.yearOpened;
+        found = this->groupsByKey.insert(key, group);
+    }
+
+    Group& group = found.value();
+    GroupTotals& totals = group.totals;
+    totals.teams++;
+
+    // A stadium only counts the first time one of the group's teams uses it.
+    if (!group.capacity.add(record))
+    {
+        return;
+    }
+    totals.stadiums = group.capacity.stadiumCount();
+    totals.totalCapacity = group.capacity.total();
+    totals.smallestCapacity = std::min(totals.smallestCapacity, record.seatingCapacity);
+    totals.largestCapacity = std::max(totals.largestCapacity, record.seatingCapacity);
+    if (record.yearOpened < totals.oldestYear)
+    {
+        totals.oldestStadium = record.stadiumName;
+        totals.oldestYear = record.yearOpened;
+    }
+    if (record.yearOpened > totals.newestYear)
+    {
+        totals.newestStadium = record.stadiumName;
+        totals.newestYear = record.yearOpened;
+    }
+}
@@ -1,7 +1,15 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "loginwindow.h"
+#include <QAbstractItemView>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QLocale>
+#include <QMessageBox>
+#include <QSignalBlocker>
+#include <QTableWidget>
+#include <iterator>
+#include <limits>
 
 // MainWindow constructor
 MainWindow::MainWindow(QWidget *parent)
@@ -23,11 +31,68 @@ MainWindow::MainWindow(QWidget *parent)
     // Connect the "displayUpdated" signal of the table widget to the "updateTotalCapacity" slot of this class
     QObject::connect(this->ui->tableWidget, SIGNAL(displayUpdated()), this, SLOT(updateTotalCapacity()));
 
-    // Connect the "triggered" signal of the "Display Conference" menu to the "displayConference" slot of this class
-    QObject::connect(this->ui->menuDisplay_Conference, SIGNAL(triggered(QAction*)), this, SLOT(displayConference(QAction*)));
+    // The "Display ..." menus, each of which narrows the table down to one value of its column
+    this->facetMenus = {
+        {this->ui->menuDisplay_Conference, Column::Conference, "No Conferences Found"},
+        {this->ui->menuDisplay_Division, Column::Division, "No Divisions Found"},
+        {this->ui->menuDisplay_Surface_Type, Column::SurfaceType, "No Surface Types Found"},
+        {this->ui->menuDisplay_Roof_Type, Column::RoofType, "No Roof Types Found"},
+        {this->ui->menuDisplay_State, Column::State, "No States Found"}
+    };
 
-    // Connect the "listsUpdated" signal of the table widget to the "redisplayConferenceMenu" slot of this class
-    QObject::connect(this->ui->tableWidget, SIGNAL(listsUpdated()), this, SLOT(redisplayConferenceMenu()));
+    // Connect the "triggered" signal of each of the "Display ..." menus to the "displayFacet" slot of this class
+    for (int i = 0; i < this->facetMenus.size(); i++) {
+        QObject::connect(this->facetMenus[i].menu, SIGNAL(triggered(QAction*)), this, SLOT(displayFacet(QAction*)));
+    }
+
+    // Connect the "listsUpdated" signal of the table widget to the "redisplayFacetMenus" slot of this class
+    QObject::connect(this->ui->tableWidget, SIGNAL(listsUpdated()), this, SLOT(redisplayFacetMenus()));
+
+    // Connect the "valueChanged" signal of each of the range boxes to the "displayRanges" slot of this class
+    QObject::connect(this->ui->capacityMinimumSpin, SIGNAL(valueChanged(int)), this, SLOT(displayRanges()));
+    QObject::connect(this->ui->capacityMaximumSpin, SIGNAL(valueChanged(int)), this, SLOT(displayRanges()));
+    QObject::connect(this->ui->yearMinimumSpin, SIGNAL(valueChanged(int)), this, SLOT(displayRanges()));
+    QObject::connect(this->ui->yearMaximumSpin, SIGNAL(valueChanged(int)), this, SLOT(displayRanges()));
+
+    // Fill in the columns the summary page can group by, which starts off grouping by conference
+    this->ui->thenByCombo->addItem("Nothing", -1);
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        this->ui->groupByCombo->addItem(columnName(static_cast<Column>(column)), column);
+        this->ui->thenByCombo->addItem(columnName(static_cast<Column>(column)), column);
+    }
+    this->ui->groupByCombo->setCurrentIndex(this->ui->groupByCombo->findData(static_cast<int>(Column::Conference)));
+
+    // Redo the summary when the columns it groups by change, or when teams are loaded
+    QObject::connect(this->ui->groupByCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(redisplaySummary()));
+    QObject::connect(this->ui->thenByCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(redisplaySummary()));
+    QObject::connect(this->ui->tableWidget, SIGNAL(listsUpdated()), this, SLOT(redisplaySummary()));
+
+    // Set up the completer of the search box. The names it offers are filled in as the user types, so it doesn't have to filter them itself
+    this->searchCompletions = new QStringListModel(this);
+    this->searchCompleter = new QCompleter(this->searchCompletions, this);
+    this->searchCompleter->setCaseSensitivity(Qt::CaseInsensitive);
+    this->searchCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    this->searchCompleter->setMaxVisibleItems(CompletionIndex::TOP_COUNT);
+    this->ui->searchEdit->setCompleter(this->searchCompleter);
+
+    // Set up the loader that reads files on another thread, with a progress bar and a cancel button in the status bar that are only shown while it is reading
+    this->loader = new DatasetLoader(this);
+    this->loadingOriginal = false;
+    this->loadProgress = new QProgressBar(this);
+    this->loadProgress->setRange(0, 100);
+    this->loadProgress->setVisible(false);
+    this->cancelLoadButton = new QPushButton(tr("Cancel"), this);
+    this->cancelLoadButton->setVisible(false);
+    this->ui->statusbar->addPermanentWidget(this->loadProgress);
+    this->ui->statusbar->addPermanentWidget(this->cancelLoadButton);
+
+    QObject::connect(this->loader, SIGNAL(progressChanged(int)), this->loadProgress, SLOT(setValue(int)));
+    QObject::connect(this->cancelLoadButton, SIGNAL(clicked()), this->loader, SLOT(cancel()));
+    QObject::connect(this->loader, SIGNAL(finished()), this, SLOT(loadFinished()));
+
+    // Set up the query service, which isn't started until the "Serve Queries" action is checked, and give it the lists whenever they change
+    this->queryService = new QueryService(this);
+    QObject::connect(this->ui->tableWidget, SIGNAL(listsUpdated()), this, SLOT(updateQueryService()));
 }
 
 // MainWindow destructor
@@ -54,6 +119,64 @@ void MainWindow::on_actionHelp_triggered() {
     this->ui->stackedWidget->setCurrentIndex(2);
 }
 
+// Slot that is called when the "Summary" action is triggered
+void MainWindow::on_actionSummary_triggered() {
+    // Set the current index of the stacked widget to 3
+    this->ui->stackedWidget->setCurrentIndex(3);
+    this->redisplaySummary();
+}
+
+// Slot that fills in the summary page with the totals of each group of teams, if it is the page being shown
+void MainWindow::redisplaySummary() {
+    if (this->ui->stackedWidget->currentWidget() != this->ui->summaryPage) {
+        return;
+    }
+
+    const Column first = static_cast<Column>(this->ui->groupByCombo->currentData().toInt());
+    const int second = this->ui->thenByCombo->currentData().toInt();
+    QVector<GroupTotals> groups;
+    this->ui->tableWidget->getGroupTotals(first, second, groups);
+
+    // The columns the teams are grouped by come first, then the totals
+    QStringList headers;
+    headers << columnName(first);
+    if (second > -1) {
+        headers << columnName(static_cast<Column>(second));
+    }
+    const int totalsColumn = headers.size();
+    headers << "Teams" << "Stadiums" << "Total Capacity" << "Average Capacity" << "Smallest Capacity" << "Largest Capacity" << "Oldest Stadium" << "Newest Stadium";
+
+    QTableWidget* table = this->ui->summaryTable;
+    table->clear();
+    table->setColumnCount(headers.size());
+    table->setHorizontalHeaderLabels(headers);
+    table->setRowCount(groups.size());
+
+    const QLocale english(QLocale::English);
+    for (int row = 0; row < groups.size(); row++) {
+        const GroupTotals& group = groups[row];
+        const QString cells[] = {
+            english.toString(group.teams),
+            english.toString(group.stadiums),
+            english.toString(group.totalCapacity),
+            english.toString(group.averageCapacity(), 'f', 0),
+            english.toString(group.smallestCapacity),
+            english.toString(group.largestCapacity),
+            QString("%1 (%2)").arg(group.oldestStadium).arg(group.oldestYear),
+            QString("%1 (%2)").arg(group.newestStadium).arg(group.newestYear)
+        };
+
+        table->setItem(row, 0, new QTableWidgetItem(group.first));
+        if (second > -1) {
+            table->setItem(row, 1, new QTableWidgetItem(group.second));
+        }
+        for (int i = 0; i < static_cast<int>(std::size(cells)); i++) {
+            table->setItem(row, totalsColumn + i, new QTableWidgetItem(cells[i]));
+        }
+    }
+    table->resizeColumnsToContents();
+}
+
 // Slot that is called when the "Login" action is triggered
 void MainWindow::on_actionlogin_triggered() {
     // Create a LoginWindow object and show it
@@ -92,44 +215,194 @@ void MainWindow::on_actionLoad_New_Entries_triggered() {
     // Show a file dialog that allows the user to select a CSV file
     QString filename = QFileDialog::getOpenFileName(this, tr("Select a CSV file..."), QString(), tr("CSV Files (*.csv)"));
 
-    // If a file was selected, load the update data from that file
+    // If a file was selected, start reading the update data from that file
     if (filename != "") {
-        this->ui->tableWidget->loadUpdateData(filename);
+        this->startLoading(filename, false);
+    }
+}
+
+// Starts reading the file at path on another thread, showing the progress in the status bar
+void MainWindow::startLoading(const QString& path, bool original) {
+    // Only one file can be read at a time. The original list is read from its snapshot when it hasn't changed since the last time
+    if (!this->loader->load(path, original)) {
+        QMessageBox::warning(this, "Still Loading", "Please wait for the file that is being loaded to finish first.");
+        return;
+    }
+
+    this->loadingOriginal = original;
+    this->loadProgress->setVisible(true);
+    this->cancelLoadButton->setVisible(true);
+    this->ui->statusbar->showMessage(tr("Loading %1...").arg(path));
+}
+
+// Slot that is called when the loader is done reading a file, which hands the teams to the table widget all at once
+void MainWindow::loadFinished() {
+    this->loadProgress->setVisible(false);
+    this->cancelLoadButton->setVisible(false);
+    this->ui->statusbar->clearMessage();
+
+    LoadResult result = this->loader->result();
+
+    // Let the user know what went wrong, unless they were the one who stopped it
+    if (result.error.kind == LoadError::Cancelled) {
+        this->ui->statusbar->showMessage(tr("Loading %1 was cancelled.").arg(result.path), 5000);
+        return;
+    }
+    if (result.error.kind != LoadError::None) {
+        QMessageBox::critical(this, "Error", result.error.message);
+        return;
+    }
+
+    QStringList duplicates;
+    {
+        // Update the rest of the window once, as soon as the teams are in the table
+        NFLDataTable::ChangeScope batch(this->ui->tableWidget);
+
+        if (this->loadingOriginal) {
+            this->ui->tableWidget->loadOriginalList(result.records, &result.orders);
+        }
+        else {
+            this->ui->tableWidget->addUpdates(result.records, &duplicates);
+        }
+    }
+
+    // Let the user know about any teams that were in the file more than once
+    if (!duplicates.isEmpty()) {
+        QMessageBox::warning(this, "Duplicate Teams", "These teams were in the file more than once, only the first entry for each was loaded:\n\n" + duplicates.join("\n"));
     }
 }
 
-// Slot that is called when a conference menu action is triggered
-void MainWindow::displayConference(QAction* action) {
-    if (action) {
-        // If the action's text is not "All", display the conference with the specified name
+// Slot that is called when an action in one of the "Display ..." menus is triggered
+void MainWindow::displayFacet(QAction* action) {
+    const FacetMenu* facetMenu = this->findFacetMenu(qobject_cast<QMenu*>(this->sender()));
+
+    // The action that says nothing was found doesn't do anything
+    if (action && facetMenu && action->text() != facetMenu->none) {
+        // If the action's text is not "All", display the teams with the specified value
         if (action->text() != "All") {
-            this->ui->tableWidget->displayConference(action->text());
+            this->ui->tableWidget->displayFacet(facetMenu->column, action->text());
         }
-        // Otherwise, display all conferences
+        // Otherwise, display every team
         else {
-            this->ui->tableWidget->displayConference("");
+            this->ui->tableWidget->displayFacet(facetMenu->column, "");
+        }
+    }
+}
+
+// Slot that is called when the text in the search box changes, showing only the teams that match it
+void MainWindow::on_searchEdit_textChanged(const QString& text) {
+    this->ui->tableWidget->displaySearch(text);
+}
+
+// Slot that is called when the user types in the search box, offering the names that start with the text
+void MainWindow::on_searchEdit_textEdited(const QString& text) {
+    QStringList completions;
+    if (!text.trimmed().isEmpty()) {
+        this->ui->tableWidget->getCompletions(text.trimmed(), CompletionIndex::TOP_COUNT, completions);
+    }
+    this->searchCompletions->setStringList(completions);
+
+    if (completions.isEmpty()) {
+        this->searchCompleter->popup()->hide();
+    }
+    else {
+        this->searchCompleter->setCompletionPrefix(text);
+        this->searchCompleter->complete();
+    }
+}
+
+// Slot that is called when one of the range boxes changes, narrowing the table down to the capacities and years in them
+void MainWindow::displayRanges() {
+    NFLDataTable::ChangeScope changes(this->ui->tableWidget);
+    this->displayRange(Column::SeatingCapacity, this->ui->capacityMinimumSpin->value(), this->ui->capacityMaximumSpin->value());
+    this->displayRange(Column::YearOpened, this->ui->yearMinimumSpin->value(), this->ui->yearMaximumSpin->value());
+}
+
+// Slot that is called when the "Filter Teams..." action is triggered, asking for a filter until it is given one that works or is cancelled
+void MainWindow::on_actionFilter_Teams_triggered() {
+    QString text = this->ui->tableWidget->getExpression();
+
+    while (true) {
+        bool okay = false;
+        text = QInputDialog::getText(this, "Filter Teams",
+                                     "Only show the teams where (for example: roof = \"Retractable\" AND capacity > 65000 OR division = \"AFC West\"),\nor leave it empty to show every team:",
+                                     QLineEdit::Normal, text, &okay);
+        if (!okay) {
+            return;
+        }
+
+        QString error;
+        if (this->ui->tableWidget->displayExpression(text, &error)) {
+            return;
+        }
+        QMessageBox::warning(this, "Filter Teams", "That filter doesn't work:\n\n" + error);
+    }
+}
+
+// Narrows the table down to the teams with column from minimum to maximum, where 0 (shown as "Any") means there is no limit on that end
+void MainWindow::displayRange(Column column, int minimum, int maximum) {
+    if (minimum == 0 && maximum == 0) {
+        this->ui->tableWidget->clearRange(column);
+    }
+    else {
+        this->ui->tableWidget->displayRange(column, minimum, maximum == 0 ? std::numeric_limits<quint32>::max() : maximum);
+    }
+}
+
+// Finds which of the "Display ..." menus menu is, or returns nullptr if it isn't one of them
+const MainWindow::FacetMenu* MainWindow::findFacetMenu(QMenu* menu) const {
+    for (int i = 0; i < this->facetMenus.size(); i++) {
+        if (this->facetMenus[i].menu == menu) {
+            return &this->facetMenus[i];
         }
     }
+    return nullptr;
 }
 
-// Slot that updates the "Display Conference" menu with the list of conferences
-void MainWindow::redisplayConferenceMenu() {
-    // Get the list of conferences from the table widget
-    QVector<QString> conferences;
-    this->ui->tableWidget->getConferences(conferences);
+// Slot that updates each of the "Display ..." menus with the values the teams have
+void MainWindow::redisplayFacetMenus() {
+    for (int i = 0; i < this->facetMenus.size(); i++) {
+        this->redisplayFacetMenu(this->facetMenus[i]);
+    }
+}
 
-    // Clear the "Display Conference" menu
-    this->ui->menuDisplay_Conference->clear();
+// Updates one of the "Display ..." menus with the values its column has
+void MainWindow::redisplayFacetMenu(const FacetMenu& facetMenu) {
+    // Get the list of values from the table widget
+    QVector<QString> values;
+    this->ui->tableWidget->getFacetValues(facetMenu.column, values);
 
-    // If there are no conferences, add an action that says "No Conferences Found"
-    if (conferences.size() < 1) {
-        this->ui->menuDisplay_Conference->addAction("No Conferences Found");
+    // Work out which actions the menu should have: an "All" action and an action for each value, or an action that says none were found if there are none
+    QStringList wanted;
+    if (values.size() < 1) {
+        wanted.append(facetMenu.none);
     }
-    // Otherwise, add an "All" action and an action for each conference
     else {
-        this->ui->menuDisplay_Conference->addAction("All");
-        for (int i = 0; i < conferences.size(); i++) {
-            this->ui->menuDisplay_Conference->addAction(conferences[i]);
+        wanted.append("All");
+        for (int i = 0; i < values.size(); i++) {
+            wanted.append(values[i]);
+        }
+    }
+
+    // Only change the actions that are different, most of the time none of the values have changed
+    QMenu* menu = facetMenu.menu;
+    QList<QAction*> actions = menu->actions();
+    for (int i = 0; i < actions.size(); i++) {
+        if (!wanted.contains(actions[i]->text())) {
+            menu->removeAction(actions[i]);
+            delete actions[i];
+        }
+    }
+
+    // What is left is in the right order, so the missing actions just need to go in between
+    actions = menu->actions();
+    int next = 0;
+    for (int i = 0; i < wanted.size(); i++) {
+        if (next < actions.size() && actions[next]->text() == wanted[i]) {
+            next++;
+        }
+        else {
+            menu->insertAction(next < actions.size() ? actions[next] : nullptr, new QAction(wanted[i], menu));
         }
     }
 }
@@ -139,6 +412,32 @@ void MainWindow::show() {
     // Call the base implementation of QWidget::show
     QMainWindow::show();
 
-    // Load the original data from the "NFL Information.csv" file
-    this->ui->tableWidget->loadOriginalData("NFL Information.csv");
+    // Start reading the original data from the "NFL Information.csv" file, the window stays usable while it is read
+    this->startLoading("NFL Information.csv", true);
+}
+
+// Slot that starts or stops answering queries from other programs on this computer when the "Serve Queries" action is toggled
+void MainWindow::on_actionServe_Queries_toggled(bool checked) {
+    if (!checked) {
+        this->queryService->stop();
+        this->ui->statusbar->showMessage(tr("Stopped serving queries."), 5000);
+        return;
+    }
+
+    // The service only gets the lists while it is running, so give it the ones that are already loaded
+    this->queryService->setLists(this->ui->tableWidget->getOriginalList(), this->ui->tableWidget->getUpdates());
+    if (!this->queryService->start()) {
+        QMessageBox::warning(this, "Serve Queries", tr("Could not listen on port %1:\n\n%2").arg(QueryService::DEFAULT_PORT).arg(this->queryService->errorString()));
+        const QSignalBlocker blocker(this->ui->actionServe_Queries);
+        this->ui->actionServe_Queries->setChecked(false);
+        return;
+    }
+    this->ui->statusbar->showMessage(tr("Serving queries on http://localhost:%1/teams").arg(this->queryService->serverPort()));
+}
+
+// Slot that gives the query service the lists as they are now, so it answers queries about the teams that are loaded
+void MainWindow::updateQueryService() {
+    if (this->queryService->isListening()) {
+        this->queryService->setLists(this->ui->tableWidget->getOriginalList(), this->ui->tableWidget->getUpdates());
+    }
 }
@@ -0,0 +1,156 @@
+#include <utility>
+#include "csv.h"
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace csv {
+    MappedFile::MappedFile() : data(nullptr), size(0), opened(false)
+#ifdef _WIN32
+        , fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+    {}
+
+    MappedFile::MappedFile(const char* fileName) : MappedFile() {
+        open(fileName);
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile() {
+        swap(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void MappedFile::swap(MappedFile& other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(opened, other.opened);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+
+    // Maps the whole file into memory as read only. Any file that was already
+    // mapped by this object is released first.
+    //
+    // Throws csv::FileError if the file could not be opened or mapped.
+    void MappedFile::open(const char* fileName) {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw FileError("Could not open the file.");
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw FileError("Could not read the size of the file.");
+        }
+
+        // Windows refuses to map an empty file, but an empty file is still a
+        // perfectly valid (if boring) csv file.
+        if (fileSize.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping) {
+                CloseHandle(file);
+                throw FileError("Could not map the file into memory.");
+            }
+
+            void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!view) {
+                CloseHandle(mapping);
+                CloseHandle(file);
+                throw FileError("Could not map the file into memory.");
+            }
+
+            mappingHandle = mapping;
+            data = static_cast<const char*>(view);
+            size = static_cast<std::size_t>(fileSize.QuadPart);
+        }
+        fileHandle = file;
+#else
+        int file = ::open(fileName, O_RDONLY);
+        if (file < 0) {
+            throw FileError("Could not open the file.");
+        }
+
+        struct stat fileInfo;
+        if (fstat(file, &fileInfo) != 0) {
+            ::close(file);
+            throw FileError("Could not read the size of the file.");
+        }
+
+        // mmap does not allow a length of 0, so empty files are left unmapped.
+        if (fileInfo.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<std::size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (view == MAP_FAILED) {
+                ::close(file);
+                throw FileError("Could not map the file into memory.");
+            }
+            // We read the file front to back, so let the kernel read ahead.
+            madvise(view, static_cast<std::size_t>(fileInfo.st_size), MADV_SEQUENTIAL);
+
+            data = static_cast<const char*>(view);
+            size = static_cast<std::size_t>(fileInfo.st_size);
+        }
+
+        // The mapping keeps its own reference to the file, so the descriptor
+        // is not needed anymore.
+        ::close(file);
+#endif
+        opened = true;
+    }
+
+    // Releases the mapping. Any views into the file are invalid afterwards.
+    void MappedFile::close() {
+#ifdef _WIN32
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        if (fileHandle) {
+            CloseHandle(fileHandle);
+        }
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+        opened = false;
+    }
+
+    bool MappedFile::isOpen() const {
+        return opened;
+    }
+
+    std::string_view MappedFile::view() const {
+        return std::string_view(data, size);
+    }
+}
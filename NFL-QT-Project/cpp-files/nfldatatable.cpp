@@ -2,11 +2,51 @@
 #include "csv.h"
 #include "nfldatatable.h"
 #include "sort.h"
+#include "utils.h"
+#include <algorithm>
+#include <QHash>
 #include <QHeaderView>
+#include <QMessageBox>
+#include <QtAlgorithms>
 
 
-NFLDataTable::NFLDataTable(QWidget *parent) : QTableWidget(parent)
+namespace
 {
+    // A facet with fewer rows than one in this many of all the rows is sorted
+    // on its own, rather than picked out of the order of every row.
+    const int FACET_SORT_FRACTION = 8;
+
+    // Gets the value of :param column:, which has to be a number column, from :param record:.
+    quint32 rangeValue(const TeamRecord& record, Column column)
+    {
+        if (column == Column::SeatingCapacity)
+        {
+            return record.seatingCapacity;
+        }
+        return record.yearOpened;
+    }
+
+    // Reads a file with readRowsFromFile, showing the user what went wrong if
+    // it doesn't work.
+    bool loadRowsFromFile(std::string path, QVector<TeamRecord>& out)
+    {
+        LoadError error;
+
+        if (!readRowsFromFile(path, out, &error))
+        {
+            QMessageBox::critical(nullptr, "Error", error.message);
+            return false;
+        }
+        return true;
+    }
+}
+
+
+NFLDataTable::NFLDataTable(QWidget *parent) : QTableView(parent)
+{
+    this->tableModel = new NFLTableModel(this->rows, this);
+    this->setModel(this->tableModel);
+
     // Setup the table so the user can't modify all of the cells.
     this->setEditTriggers(QAbstractItemView::NoEditTriggers);
     this->setSelectionMode(QAbstractItemView::NoSelection);
@@ -14,377 +54,927 @@ NFLDataTable::NFLDataTable(QWidget *parent) : QTableWidget(parent)
     this->onlyShowingOriginal = false;
     this->lastColumn = -1;
     this->originalLoaded = false;
+    this->facetColumn = -1;
+    this->facetMember = nullptr;
+    this->facetCode = 0;
+    this->searchRanked = false;
+    this->expressionCount = 0;
+    this->changeDepth = 0;
+    this->flushQueued = false;
+    this->listsChanged = false;
+    this->displayChanged = false;
+    this->sortIndicatorChanged = false;
 
     this->horizontalHeader()->setSortIndicatorShown(true);
 
     // Set it up so that clicking on a column will call the sort function.
     QObject::connect(reinterpret_cast<QObject*>(this->horizontalHeader()), SIGNAL(sectionClicked(int)), this, SLOT(sort(int)));
+
+    // Keep the total capacity up to date as rows come and go from the view.
+    QObject::connect(this->tableModel, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)), this, SLOT(rowsLeavingView(QModelIndex,int,int)));
+    QObject::connect(this->tableModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(rowsEnteredView(QModelIndex,int,int)));
+    QObject::connect(this->tableModel, SIGNAL(modelReset()), this, SLOT(viewReset()));
 }
 
 
-void NFLDataTable::addRow(ROW& row)
+void NFLDataTable::addRow(const TeamRecord& row)
 {
-    ROW& newRow = this->updates.emplace_back();
+    const int firstNew = this->rows.size();
 
-    for (int i = 0; i < 10; i++)
+    this->updates.push_back(row);
+    this->teamNames.insert(row.teamName);
+    this->indexRows();
+    this->showAddedRows(firstNew);
+
+    this->markListsChanged();
+}
+
+
+NFLDataTable::ChangeScope::ChangeScope(NFLDataTable* table) : table(table)
+{
+    this->table->changeDepth++;
+}
+
+
+// Ending the last scope sends everything that changed inside of it straight away.
+NFLDataTable::ChangeScope::~ChangeScope()
+{
+    if (--this->table->changeDepth == 0)
     {
-        newRow[i] = row[i];
+        this->table->flushChanges();
     }
+}
 
-    emit listsUpdated();
 
-    if (!this->onlyShowingOriginal)
+// Notes that rows were added to or taken from the lists, so listsUpdated gets sent.
+void NFLDataTable::markListsChanged()
+{
+    this->listsChanged = true;
+    this->queueFlush();
+}
+
+
+// Notes that the rows in the view changed, so displayUpdated gets sent.
+void NFLDataTable::markDisplayChanged()
+{
+    this->displayChanged = true;
+    this->queueFlush();
+}
+
+
+/*
+ * Sends the changes once control gets back to the event loop, so any number of
+ * changes made in one go only send each signal once. Inside of a ChangeScope
+ * they are sent when the scope ends instead.
+ */
+void NFLDataTable::queueFlush()
+{
+    if (this->changeDepth == 0 && !this->flushQueued)
     {
-        this->showUpdatedList();
+        this->flushQueued = true;
+        QMetaObject::invokeMethod(this, "flushChanges", Qt::QueuedConnection);
+    }
+}
+
+
+// Sends a signal for each kind of change made since the last time.
+void NFLDataTable::flushChanges()
+{
+    this->flushQueued = false;
+
+    // A scope that is still open will send them when it ends.
+    if (this->changeDepth > 0)
+    {
+        return;
+    }
+
+    // Clear the flags first, in case anything connected to the signals
+    // changes the table again.
+    const bool lists = this->listsChanged;
+    const bool display = this->displayChanged;
+    this->listsChanged = false;
+    this->displayChanged = false;
+
+    if (this->sortIndicatorChanged)
+    {
+        this->sortIndicatorChanged = false;
+        this->horizontalHeader()->setSortIndicator(this->lastColumn, this->ascending ? Qt::AscendingOrder : Qt::DescendingOrder);
+    }
+    if (lists)
+    {
+        emit listsUpdated();
+    }
+    if (display)
+    {
+        emit displayUpdated();
     }
 }
 
 
 unsigned long long NFLDataTable::getTotalCapacity() const
 {
-    QVector<QString> foundStadiums;
-    QString stadium;
-    unsigned long long total = 0;
+    // The total is kept up to date as teams are shown and hidden, so there is
+    // nothing to add up here.
+    return this->displayCapacity.total();
+}
+
+
+const QVector<TeamRecord>& NFLDataTable::getOriginalList() const
+{
+    return this->originalList;
+}
+
+
+const QVector<TeamRecord>& NFLDataTable::getUpdates() const
+{
+    return this->updates;
+}
+
 
-    for (auto rowIt = this->displayData.begin(); rowIt != this->displayData.end(); rowIt++)
+void NFLDataTable::rowsLeavingView(const QModelIndex&, int first, int last)
+{
+    for (int row = first; row <= last; row++)
     {
-        // Use `*rowit` to actually get the row itself before trying to index it for the stadium or the capacity.
-        // This line gets the row, gets the stadium name from the row, gets the data from that space, then gets the string for that data.
-        stadium = (*rowIt)[1]->data(0).toString();
+        this->displayCapacity.remove(*this->tableModel->record(row));
+    }
+}
 
-        if (!foundStadiums.contains(stadium))
-        {
-            total += qvarToULongLong((*rowIt)[2]->data(0));
-            foundStadiums.push_back(stadium);
-        }
+
+void NFLDataTable::rowsEnteredView(const QModelIndex&, int first, int last)
+{
+    for (int row = first; row <= last; row++)
+    {
+        this->displayCapacity.add(*this->tableModel->record(row));
     }
+}
 
-    return total;
+
+void NFLDataTable::viewReset()
+{
+    this->displayCapacity.clear();
+    this->rowsEnteredView(QModelIndex(), 0, this->tableModel->rowCount() - 1);
 }
 
 
 void NFLDataTable::getConferences(QVector<QString> &out)
 {
-    out.clear();
+    this->getFacetValues(Column::Conference, out);
+}
+
+
+/*
+ * Gets the different values of :param column: (which has to be one of
+ * FACET_COLUMNS) between the teams in the list being shown, in order. They are
+ * kept up to date as teams are added, so this doesn't look at any of the teams.
+ */
+void NFLDataTable::getFacetValues(Column column, QVector<QString>& out) const
+{
+    this->facets.values(column, this->onlyShowingOriginal ? this->originalList.size() : this->rows.size(), out);
+}
 
-    QString name;
 
-    // Add all items from the original list that are of the correct conference.
-    for (int i = 0; i < this->originalList.size(); i++)
+/*
+ * Gets up to :param limit: team, stadium, city and state names that start with
+ * :param prefix:, the ones the most teams have first. Every team that has been
+ * loaded is counted, whichever list is being shown.
+ */
+void NFLDataTable::getCompletions(const QString& prefix, int limit, QStringList& out) const
+{
+    this->completions.complete(prefix, limit, out);
+}
+
+
+/*
+ * Gets the totals of every group of teams with the same value of
+ * :param first: (and of :param second:, if it isn't -1). Every team that has
+ * been loaded is counted, whichever list is being shown. Each grouping is only
+ * worked out the first time it is asked for, after that only the teams added
+ * since the last time are added to it.
+ */
+void NFLDataTable::getGroupTotals(Column first, int second, QVector<GroupTotals>& out)
+{
+    const int key = static_cast<int>(first) * (COLUMN_COUNT + 1) + second + 1;
+    auto found = this->summaries.find(key);
+    if (found == this->summaries.end())
     {
-        name = this->originalList[i][5]->data(0).toString();
-        if (!out.contains(name))
-        {
-            out.push_back(name);
-        }
+        found = this->summaries.insert(key, GroupSummary(first, second));
     }
 
-    // Only do this part if we are not displaying the original list only.
-    if (!this->onlyShowingOriginal)
+    found.value().update(this->rows);
+    found.value().groups(out);
+}
+
+
+void NFLDataTable::sort(int column)
+{
+    if (this->lastColumn != column)
     {
-        // Add all items from the updates list that are of the correct conference.
-        for (int i = 0; i < this->updates.size(); i++)
-        {
-            name = this->updates[i][5]->data(0).toString();
-            if (!out.contains(name))
-            {
-                out.push_back(name);
-            }
-        }
+        this->ascending = true;
     }
+    this->lastColumn = column;
 
-    // Sort the results.
-    std::sort(out.begin(), out.end());
+    // Swap the ascending value. The rows are put in the opposite order to it,
+    // so the first click on a column sorts it from smallest to largest.
+    this->ascending = !this->ascending;
+    this->sortIndicatorChanged = true;
+    this->searchRanked = false;
+
+    // The same rows are shown, just in a different order.
+    this->tableModel->reorder(this->viewRows());
+    this->markDisplayChanged();
 }
 
 
-void NFLDataTable::redisplayData()
+/*
+ * Gets every row that is part of the current view (as indexes into rows), in
+ * the order of the last column that was sorted. The order comes from
+ * sortedOrders, so nothing gets sorted again unless the column and direction
+ * have never been used before.
+ */
+QVector<int> NFLDataTable::viewRows()
 {
-    if (this->rowCount() != this->displayData.size())
+    QVector<int> shown;
+
+    if (this->searchText.size() >= SearchIndex::MIN_LENGTH)
     {
-        this->setRowCount(this->displayData.size());
+        this->searchRows(shown);
+        return shown;
     }
-    for (int row = 0; row < this->rowCount(); row++)
+
+    if (this->facetColumn > -1 || !this->ranges.isEmpty() || !this->expression.isEmpty())
     {
-        for (int col = 0; col < 10; col++)
+        this->filteredRows(shown);
+        return shown;
+    }
+
+    shown.reserve(this->rows.size());
+
+    if (this->lastColumn > -1)
+    {
+        const std::vector<int>& order = this->sortedOrders.order(this->rows, static_cast<Column>(this->lastColumn), !this->ascending, &this->sortKeys);
+
+        for (auto it = order.cbegin(); it != order.cend(); it++)
         {
-            // We specifically give a copy so that our data won't be deleted. QT just doesn't
-            // understand the concept of "I didn't make this data, it's not my job to delete
-            // it" and is deleting things when they may still have a use. It also physically
-            // prevents you from adding one of the items to a table after it has been added
-            // to one already, so this has a secondary benefit of allowing us to place things
-            // easily with the setItem function.
-            this->setItem(row, col, new QTableWidgetItem(*this->displayData[row][col]));
+            if (this->inView(*it))
+            {
+                shown.push_back(*it);
+            }
         }
     }
-    emit displayUpdated();
+    else
+    {
+        for (int row = 0; row < this->rows.size(); row++)
+        {
+            if (this->inView(row))
+            {
+                shown.push_back(row);
+            }
+        }
+    }
+    return shown;
 }
 
 
-void NFLDataTable::sort(int column)
+/*
+ * Gets the rows that pass the facet, range and expression filters, in the order
+ * of the last column that was sorted. The filter with the fewest rows gives the
+ * rows to look at: a facet's rows come from the facet index, the expression's
+ * rows come from its bits, and a range's rows are a slice of the column's
+ * sorted order found with a binary search. The rest of
+ * the filters are checked on just those rows. When there aren't many of them
+ * they are sorted on their own, otherwise they are picked out of the cached
+ * order like in viewRows.
+ */
+void NFLDataTable::filteredRows(QVector<int>& out)
 {
-    bool first = true;
-    // This variable is used to check for ties in the last column.
-    int lastCheckedColumn = -1;
-    int tieFound = false;
-    int tieStart = 0;
-    QTableWidgetItem* lastItem = nullptr;
+    const int* first = nullptr;
+    const int* last = nullptr;
+    // If the rows come from a range, and if that range is of the column the
+    // table is sorted by.
+    bool fromRange = false;
+    bool inOrder = false;
+
+    if (this->facetColumn > -1)
+    {
+        const QVector<int>* matching = this->facets.rows(static_cast<Column>(this->facetColumn), this->facetValue);
+        if (!matching)
+        {
+            return;
+        }
+        first = matching->constData();
+        last = first + matching->size();
+    }
 
-    while (true)
+    QVector<int> passedExpression;
+    if (!this->expression.isEmpty() && (!first || this->expressionCount < last - first))
     {
-        if (first)
+        passedExpression.reserve(this->expressionCount);
+        for (std::size_t word = 0; word < this->expressionBits.size(); word++)
         {
-            if (this->lastColumn != column)
+            for (quint64 bits = this->expressionBits[word]; bits; bits &= bits - 1)
             {
-                this->ascending = true;
+                passedExpression.push_back(static_cast<int>(word * 64 + qCountTrailingZeroBits(bits)));
             }
-            this->lastColumn = column;
+        }
+        first = passedExpression.constData();
+        last = first + passedExpression.size();
+    }
+
+    for (auto range = this->ranges.cbegin(); range != this->ranges.cend(); range++)
+    {
+        // If the table is sorted by the range's column, take the slice of the
+        // order that is shown, since it then comes out already in order.
+        const bool sortedBy = static_cast<int>(range->column) == this->lastColumn;
+        const std::vector<int>& order = this->sortedOrders.order(this->rows, range->column, sortedBy ? !this->ascending : true, &this->sortKeys);
+        const std::pair<const int*, const int*> slice = this->rangeSlice(*range, order, sortedBy ? !this->ascending : true);
 
-            // Sort the data and swap the ascending value at the same time.
-            sortColumn(this->displayData, 0, this->displayData.size(), column, (this->ascending = !this->ascending));
-            this->horizontalHeader()->setSortIndicator(column, this->ascending ? Qt::AscendingOrder : Qt::DescendingOrder);
+        if (!first || slice.second - slice.first < last - first)
+        {
+            first = slice.first;
+            last = slice.second;
+            fromRange = true;
+            inOrder = sortedBy;
         }
-        else
+    }
+
+    const int count = last - first;
+
+    // The slice of the order being shown only has to have the other filters
+    // checked.
+    if (inOrder)
+    {
+        out.reserve(count);
+        for (const int* it = first; it != last; it++)
         {
-            for (int i = 0; i < this->displayData.size(); i++)
-            {
-                // If the item exists then we need to check it, otherwise we are
-                // looking at the first location and can't do a comparison.
-                if (lastItem)
-                {
-                    // If they are equal, then see if we already found a tie and
-                    // continue it.
-                    if (*this->displayData[i][lastCheckedColumn] == *lastItem)
-                    {
-                        if (!tieFound)
-                        {
-                            tieFound = true;
-                            tieStart = i - 1;
-                        }
-                    }
-                    else
-                    {
-                        // If we found a tie and no longer found one, then sort
-                        // that data.
-                        if (tieFound)
-                        {
-                            sortColumn(this->displayData, tieStart, i, column, this->ascending);
-                            tieFound = false;
-                        }
-                    }
-                }
-                lastItem = this->displayData[i][lastCheckedColumn];
-            }
-            if (tieFound)
+            if (this->passesFilters(*it))
             {
-                sortColumn(this->displayData, tieStart, this->displayData.size(), column, this->ascending);
-                tieFound = false;
+                out.push_back(*it);
             }
-            lastItem = nullptr;
         }
+        return;
+    }
 
-        first = false;
-        lastCheckedColumn = column;
+    QVector<int> matching;
+    matching.reserve(count);
+    for (const int* it = first; it != last; it++)
+    {
+        if (this->passesFilters(*it))
+        {
+            matching.push_back(*it);
+        }
+    }
 
-        if (column == 4)
+    // Rows from the facet index are already in order, a slice of a sorted
+    // order isn't.
+    if (fromRange)
+    {
+        std::sort(matching.begin(), matching.end());
+    }
+
+    if (this->lastColumn < 0)
+    {
+        out = matching;
+        return;
+    }
+
+    if (matching.size() * FACET_SORT_FRACTION < this->rows.size())
+    {
+        QVector<const TeamRecord*> records;
+        records.reserve(matching.size());
+        for (auto it = matching.cbegin(); it != matching.cend(); it++)
         {
-            column = 3;
+            records.push_back(this->rows[*it]);
         }
-        else if (column == 0)
+
+        // The rows are passed in order, so ties stay in the same order as in
+        // the cached orders.
+        std::vector<int> order;
+        sortOrder(records, sortKeysFor(static_cast<Column>(this->lastColumn), !this->ascending), order, &this->sortKeys);
+        out.reserve(matching.size());
+        for (auto it = order.cbegin(); it != order.cend(); it++)
         {
-            break;
+            out.push_back(matching[*it]);
         }
-        else
+        return;
+    }
+
+    std::vector<char> passed(this->rows.size(), 0);
+    for (auto it = matching.cbegin(); it != matching.cend(); it++)
+    {
+        passed[*it] = 1;
+    }
+
+    out.reserve(matching.size());
+    const std::vector<int>& order = this->sortedOrders.order(this->rows, static_cast<Column>(this->lastColumn), !this->ascending, &this->sortKeys);
+    for (auto it = order.cbegin(); it != order.cend(); it++)
+    {
+        if (passed[*it])
         {
-            column = 0;
+            out.push_back(*it);
         }
     }
-    this->redisplayData();
 }
 
 
-void NFLDataTable::redisplaySorted()
+/*
+ * Finds the part of :param order: (the sorted order of the range's column,
+ * smallest first if :param ascending:) that is inside :param range:.
+ */
+std::pair<const int*, const int*> NFLDataTable::rangeSlice(const NumberRange& range, const std::vector<int>& order, bool ascending) const
 {
-    // If the data was sorted before, swap the value of ascending and call
-    // sort, which will swap it back before doing the sorting, ensuring
-    // that it sorts identically to before. Otherwise just redisplay.
-    if (this->lastColumn > -1)
+    auto value = [this, &range](int row)
     {
-        this->ascending = !this->ascending;
-        this->sort(this->lastColumn);
-    }
-    else
+        return rangeValue(*this->rows[row], range.column);
+    };
+
+    const int* begin = order.data();
+    const int* end = begin + order.size();
+    if (ascending)
     {
-        this->redisplayData();
+        return std::make_pair(std::partition_point(begin, end, [&](int row) { return value(row) < range.minimum; }),
+                              std::partition_point(begin, end, [&](int row) { return value(row) <= range.maximum; }));
     }
+    return std::make_pair(std::partition_point(begin, end, [&](int row) { return value(row) > range.maximum; }),
+                          std::partition_point(begin, end, [&](int row) { return value(row) >= range.minimum; }));
 }
 
 
-void NFLDataTable::loadUpdateData(QString path)
+/*
+ * Gets the rows that match the text being searched for and are part of the
+ * current view. Straight after a search they come out best match first, and
+ * after a column is sorted they come out in the order of the column.
+ */
+void NFLDataTable::searchRows(QVector<int>& out)
 {
-    QVector<ROW> readEntries;
-    loadRowsFromFile(path.toStdString(), readEntries);
-    bool notFound = true;
+    const QVector<SearchMatch>& matches = this->search.search(this->searchText);
 
-    for (auto it = readEntries.begin(); it != readEntries.end(); it++)
+    if (this->searchRanked)
     {
-        // Check first to see if the entry is in the originalList.
-        for (auto checkIt = this->originalList.begin(); checkIt != this->originalList.end(); checkIt++)
+        out.reserve(matches.size());
+        for (auto it = matches.cbegin(); it != matches.cend(); it++)
         {
-            // Check the team names.
-            if ((*it)[0]->data(0) == (*checkIt)[0]->data(0))
+            if (this->passesFilters(it->row))
             {
-                notFound = false;
-                break;
+                out.push_back(it->row);
             }
         }
+        return;
+    }
 
-        // If the entry was not in the original list, check if it is in
-        // the updates list already.
-        if (notFound)
+    std::vector<char> matched(this->rows.size(), 0);
+    for (auto it = matches.cbegin(); it != matches.cend(); it++)
+    {
+        matched[it->row] = 1;
+    }
+
+    if (this->lastColumn < 0)
+    {
+        for (int row = 0; row < this->rows.size(); row++)
         {
-            for (auto checkIt = this->updates.begin(); checkIt != this->updates.end(); checkIt++)
+            if (matched[row] && this->passesFilters(row))
             {
-                // Check the team names.
-                if ((*it)[0]->data(0) == (*checkIt)[0]->data(0))
-                {
-                    notFound = false;
-                    break;
-                }
+                out.push_back(row);
             }
+        }
+        return;
+    }
 
-            // If the entry isn't already in the list, then add it to the updates.
-            if (notFound)
-            {
-                this->updates.push_back(*it);
-            }
+    const std::vector<int>& order = this->sortedOrders.order(this->rows, static_cast<Column>(this->lastColumn), !this->ascending, &this->sortKeys);
+    for (auto it = order.cbegin(); it != order.cend(); it++)
+    {
+        if (matched[*it] && this->passesFilters(*it))
+        {
+            out.push_back(*it);
         }
-        notFound = true;
     }
-    emit listsUpdated();
+}
+
+
+/*
+ * Puts the rows from :param firstNew: to the end of rows into the facets, the
+ * search index, the sorted orders and the view after they were added. They are
+ * all at the end of rows, so nothing that was there before moves. Each new row
+ * is found a place among the rows already shown with a binary search, and the
+ * view only hears about the new rows, not the whole table.
+ */
+void NFLDataTable::showAddedRows(int firstNew)
+{
+    for (int row = firstNew; row < this->rows.size(); row++)
+    {
+        this->facets.add(*this->rows[row], row);
+        this->completions.add(*this->rows[row]);
+    }
+    this->search.add(this->rows, firstNew);
+    this->sortedOrders.rowsAppended(this->rows, firstNew, &this->sortKeys);
+    this->evaluateExpression(firstNew);
+
+    if (this->onlyShowingOriginal)
+    {
+        return;
+    }
 
-    if (!this->onlyShowingOriginal)
+    // Adding rows has always gone back to showing every conference.
+    if (this->facetColumn >= 0)
     {
         this->showUpdatedList();
+        return;
+    }
+
+    // The new rows might not match the search or the other filters.
+    if (this->searchText.size() >= SearchIndex::MIN_LENGTH || !this->ranges.isEmpty() || !this->expression.isEmpty())
+    {
+        this->redisplaySorted();
+        return;
     }
+
+    QVector<int> added;
+    added.reserve(this->rows.size() - firstNew);
+    for (int row = firstNew; row < this->rows.size(); row++)
+    {
+        added.push_back(row);
+    }
+
+    // With nothing sorted the rows are shown in the order they were added, so
+    // the new ones just go on the end.
+    QVector<SortKey> keys;
+    if (this->lastColumn > -1)
+    {
+        keys = sortKeysFor(static_cast<Column>(this->lastColumn), !this->ascending);
+    }
+    auto comesBefore = [this, &keys](int first, int second)
+    {
+        return compareRecords(this->rows[first], this->rows[second], keys);
+    };
+    std::stable_sort(added.begin(), added.end(), comesBefore);
+
+    // The rows shown all came before the new ones, so a new row goes after
+    // every shown row it ties with, the same as in the sorted orders.
+    const QVector<int>& shown = this->tableModel->shownRecords();
+    QVector<int> before;
+    before.reserve(added.size());
+    for (auto it = added.cbegin(); it != added.cend(); it++)
+    {
+        before.push_back(std::upper_bound(shown.cbegin(), shown.cend(), *it, comesBefore) - shown.cbegin());
+    }
+
+    this->tableModel->insert(added, before);
+    this->markDisplayChanged();
 }
 
 
-void NFLDataTable::displayConference(QString conference)
+/*
+ * Updates the view after the rows that are part of it changed. The model only
+ * tells the view about the rows that came and went.
+ */
+void NFLDataTable::redisplaySorted()
 {
-    // If the conference is an empty string, display everything.
-    if (conference == "")
+    this->tableModel->filter(this->viewRows());
+    this->markDisplayChanged();
+}
+
+
+// Checks if the row at :param index: in rows is part of the list being shown.
+// The facet and ranges being shown are left to filteredRows.
+bool NFLDataTable::inView(int index) const
+{
+    return !this->onlyShowingOriginal || index < this->originalList.size();
+}
+
+
+// Checks if the row at :param index: in rows is part of the list being shown and passes the facet, range and expression filters.
+bool NFLDataTable::passesFilters(int index) const
+{
+    if (!this->inView(index))
     {
-        if (this->onlyShowingOriginal)
+        return false;
+    }
+
+    if (!this->expression.isEmpty() && !((this->expressionBits[index / 64] >> (index % 64)) & 1))
+    {
+        return false;
+    }
+
+    const TeamRecord& record = *this->rows[index];
+    if (this->facetColumn > -1)
+    {
+        if (this->facetMember ? record.*this->facetMember != this->facetCode : record.text(static_cast<Column>(this->facetColumn)) != this->facetValue)
         {
-            this->showOriginalList();
+            return false;
         }
-        else
+    }
+    for (auto range = this->ranges.cbegin(); range != this->ranges.cend(); range++)
+    {
+        const quint32 value = rangeValue(record, range->column);
+        if (value < range->minimum || value > range->maximum)
         {
-            this->showUpdatedList();
+            return false;
         }
-        return;
     }
+    return true;
+}
 
-    // Clear the array and prepare for data to be inserted into it.
-    this->displayData.clear();
-    if (this->displayData.capacity() < this->originalList.size() + this->updates.size())
+
+/*
+ * Rebuilds rows from originalList and updates. Has to be called any time
+ * either of them change, since adding to them can move the records.
+ */
+void NFLDataTable::indexRows()
+{
+    this->rows.clear();
+    this->rows.reserve(this->originalList.size() + this->updates.size());
+
+    for (auto it = this->originalList.cbegin(); it != this->originalList.cend(); it++)
+    {
+        this->rows.push_back(&*it);
+    }
+    for (auto it = this->updates.cbegin(); it != this->updates.cend(); it++)
     {
-        this->displayData.reserve(this->originalList.size() + this->updates.size());
+        this->rows.push_back(&*it);
     }
+}
+
 
-    // Add all items from the original list that are of the correct conference.
-    for (int index = 0; index < this->originalList.size(); index++)
+void NFLDataTable::loadUpdateData(QString path, QStringList* duplicates)
+{
+    QVector<TeamRecord> readEntries;
+    if (loadRowsFromFile(path.toStdString(), readEntries))
     {
-        if (this->originalList[index][5]->data(0).toString() == conference)
-        {
-            this->displayData.push_back(this->originalList[index]);
-        }
+        this->addUpdates(readEntries, duplicates);
     }
+}
+
 
-    // Only do this part if we are not displaying the original list only.
-    if (!this->onlyShowingOriginal)
+/*
+ * Adds the teams in :param readEntries: that aren't loaded yet to the updates.
+ * Teams that are in :param readEntries: more than once are only added the
+ * first time, and their names are put in :param duplicates: (if given).
+ */
+void NFLDataTable::addUpdates(const QVector<TeamRecord>& readEntries, QStringList* duplicates)
+{
+    const int firstNew = this->rows.size();
+
+    mergeUpdates(readEntries, this->teamNames, this->updates, duplicates);
+
+    this->indexRows();
+    this->showAddedRows(firstNew);
+
+    this->markListsChanged();
+}
+
+
+void NFLDataTable::displayConference(QString conference)
+{
+    this->displayFacet(Column::Conference, conference);
+}
+
+
+/*
+ * Only shows the teams that have :param text: in one of their columns (ignoring
+ * case, and letting longer searches be a letter or two off), best match first.
+ * Searches shorter than SearchIndex::MIN_LENGTH show every team. The search is
+ * kept when changing between the lists or facets.
+ */
+void NFLDataTable::displaySearch(QString text)
+{
+    text = text.trimmed();
+    if (text == this->searchText)
     {
-        // Add all items from the updates list that are of the correct conference.
-        for (int index = 0; index < this->updates.size(); index++)
-        {
-            if (this->updates[index][5]->data(0).toString() == conference)
-            {
-                this->displayData.push_back(this->updates[index]);
-            }
-        }
+        return;
     }
 
+    this->searchText = text;
+    this->searchRanked = true;
     this->redisplaySorted();
 }
 
 
-void NFLDataTable::showUpdatedList()
+/*
+ * Only shows the teams whose :param column: (which has to be a number column)
+ * is between :param minimum: and :param maximum:, including both. This is kept
+ * along with any facet, search or other column's range being shown, and when
+ * changing between the lists.
+ */
+void NFLDataTable::displayRange(Column column, quint32 minimum, quint32 maximum)
 {
-    this->displayData.clear();
-    // If the displayData vector does not have the size to hold
-    // the entries we are going to add, then reserve that much
-    // memory.
-    if (this->displayData.capacity() < this->originalList.size() + this->updates.size())
+    if (!isNumericColumn(column))
     {
-        this->displayData.reserve(this->originalList.size() + this->updates.size());
+        return;
     }
 
-    // Load the data from the original list.
-    for (auto it = this->originalList.begin(); it != this->originalList.end(); it++)
+    auto found = std::find_if(this->ranges.begin(), this->ranges.end(), [column](const NumberRange& range) { return range.column == column; });
+    if (found != this->ranges.end())
     {
-        this->displayData.push_back(*it);
+        if (found->minimum == minimum && found->maximum == maximum)
+        {
+            return;
+        }
+        found->minimum = minimum;
+        found->maximum = maximum;
+    }
+    else
+    {
+        this->ranges.append(NumberRange{column, minimum, maximum});
     }
+    this->redisplaySorted();
+}
 
-    // Load the data from the updates list as well.
-    for (auto it = this->updates.begin(); it != this->updates.end(); it++)
+
+// Stops narrowing the teams down by the range of :param column:.
+void NFLDataTable::clearRange(Column column)
+{
+    auto found = std::find_if(this->ranges.begin(), this->ranges.end(), [column](const NumberRange& range) { return range.column == column; });
+    if (found != this->ranges.end())
     {
-        this->displayData.push_back(*it);
+        this->ranges.erase(found);
+        this->redisplaySorted();
     }
+}
 
+
+/*
+ * Only shows the teams that pass the filter in :param text:, which is written
+ * like the ones FilterExpression describes. An empty filter shows every team.
+ * If the filter isn't valid, nothing changes and :param error: (if given) says
+ * what is wrong with it.
+ */
+bool NFLDataTable::displayExpression(const QString& text, QString* error)
+{
+    FilterExpression compiled;
+    if (!compiled.compile(text, error))
+    {
+        return false;
+    }
+
+    this->expression = compiled;
+    this->evaluateExpression(0);
     this->redisplaySorted();
-    this->onlyShowingOriginal = false;
+    return true;
 }
 
 
-void NFLDataTable::showOriginalList()
+const QString& NFLDataTable::getExpression() const
 {
-    this->displayData.clear();
-    // If the displayData vector does not have the size to hold
-    // the entries we are going to add, then reserve that much
-    // memory.
-    if (this->displayData.capacity() < this->originalList.size())
+    return this->expression.text();
+}
+
+
+// Checks the rows from :param firstRow: to the end of rows against the expression, and counts how many rows pass it.
+void NFLDataTable::evaluateExpression(int firstRow)
+{
+    if (this->expression.isEmpty())
+    {
+        this->expressionBits.clear();
+        this->expressionCount = 0;
+        return;
+    }
+
+    this->expression.evaluate(this->rows, firstRow, this->expressionBits);
+    this->expressionCount = 0;
+    for (auto it = this->expressionBits.cbegin(); it != this->expressionBits.cend(); it++)
     {
-        this->displayData.reserve(this->originalList.size());
+        this->expressionCount += qPopulationCount(*it);
     }
+}
+
 
-    // Load the data from the original list.
-    for (auto it = this->originalList.begin(); it != this->originalList.end(); it++)
+/*
+ * Only shows the teams that have :param value: in :param column: (which has
+ * to be one of FACET_COLUMNS). If the value is an empty string, display
+ * everything.
+ */
+void NFLDataTable::displayFacet(Column column, QString value)
+{
+    if (value == "")
     {
-        this->displayData.push_back(*it);
+        if (this->onlyShowingOriginal)
+        {
+            this->showOriginalList();
+        }
+        else
+        {
+            this->showUpdatedList();
+        }
+        return;
     }
 
+    this->facetColumn = static_cast<int>(column);
+    this->facetValue = value;
+
+    // Rows of an encoded column are checked by their code, so the value is
+    // only looked up in the dictionary once. A value that isn't in it yet is
+    // checked by its text instead.
+    this->facetMember = nullptr;
+    visitColumn(column, [this, &value](auto constant)
+    {
+        typedef ColumnTraits<decltype(constant)::value> Traits;
+        if constexpr (Traits::encoded)
+        {
+            if (columnDictionary(decltype(constant)::value).find(value, this->facetCode))
+            {
+                this->facetMember = Traits::member;
+            }
+        }
+    });
+    this->redisplaySorted();
+}
+
+
+void NFLDataTable::showUpdatedList()
+{
+    this->onlyShowingOriginal = false;
+    this->facetColumn = -1;
     this->redisplaySorted();
+}
+
+
+void NFLDataTable::showOriginalList()
+{
     this->onlyShowingOriginal = true;
+    this->facetColumn = -1;
+    this->redisplaySorted();
 }
 
+
 void NFLDataTable::loadOriginalData(QString path)
 {
     if (!this->originalLoaded)
     {
         loadRowsFromFile(path.toStdString(), this->originalList);
-        emit listsUpdated();
-        this->showUpdatedList();
+        this->originalListChanged();
     }
 }
 
 
-void NFLDataTable::loadOriginalList(QVector<ROW> &originalList)
+/*
+ * Shows :param originalList: as the original list. :param orders: can have
+ * the sorted orders of it that were already worked out (like the ones saved in
+ * a snapshot), so they don't have to be sorted again.
+ */
+void NFLDataTable::loadOriginalList(QVector<TeamRecord> &originalList, const SortedOrderCache* orders)
 {
     if (!this->originalLoaded)
     {
         this->originalList = originalList;
-        emit listsUpdated();
-        this->showUpdatedList();
+        this->sortKeys.clear();
+        this->originalListChanged(orders);
+    }
+}
+
+
+/*
+ * Rebuilds everything that depends on where the records are after the original
+ * list changes, then shows the updated list. Changing the original list moves
+ * every update along in rows, so the cached orders and the view have to start
+ * over instead of being patched, unless :param orders: has the orders of the
+ * new original list. Any updates are added to those like any other new rows.
+ */
+void NFLDataTable::originalListChanged(const SortedOrderCache* orders)
+{
+    this->indexTeamNames();
+    this->indexRows();
+    if (orders)
+    {
+        this->sortedOrders = *orders;
+        this->sortedOrders.rowsAppended(this->rows, this->originalList.size(), &this->sortKeys);
+    }
+    else
+    {
+        this->sortedOrders.clear();
+    }
+    this->search.clear();
+    this->search.add(this->rows);
+    this->summaries.clear();
+
+    this->facets.clear();
+    this->completions.clear();
+    for (int row = 0; row < this->rows.size(); row++)
+    {
+        this->facets.add(*this->rows[row], row);
+        this->completions.add(*this->rows[row]);
+    }
+    this->evaluateExpression(0);
+
+    this->onlyShowingOriginal = false;
+    this->facetColumn = -1;
+    this->tableModel->reset(this->viewRows());
+
+    this->markListsChanged();
+    this->markDisplayChanged();
+}
+
+
+// Rebuilds teamNames from both of the lists.
+void NFLDataTable::indexTeamNames()
+{
+    this->teamNames.clear();
+    this->teamNames.reserve(this->originalList.size() + this->updates.size());
+
+    for (auto it = this->originalList.cbegin(); it != this->originalList.cend(); it++)
+    {
+        this->teamNames.insert(it->teamName);
+    }
+    for (auto it = this->updates.cbegin(); it != this->updates.cend(); it++)
+    {
+        this->teamNames.insert(it->teamName);
     }
 }
@@ -0,0 +1,288 @@
+#include "nfltablemodel.h"
+#include <QHash>
+#include <vector>
+
+
+namespace
+{
+    // When a filter changes more separate blocks of rows than this it is
+    // quicker for the view to start over than to hear about every block.
+    const int MAX_FILTER_BLOCKS = 64;
+}
+
+
+NFLTableModel::NFLTableModel(const QVector<const TeamRecord*>& records, QObject *parent) : QAbstractTableModel(parent), records(records)
+{
+}
+
+
+int NFLTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : this->shown.size();
+}
+
+
+int NFLTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+
+QVariant NFLTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+    return this->record(index.row())->text(static_cast<Column>(index.column()));
+}
+
+
+QVariant NFLTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole)
+    {
+        return QString(columnName(static_cast<Column>(section)));
+    }
+    // The rows just get numbered.
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+
+// Gets the record shown at :param row:.
+const TeamRecord* NFLTableModel::record(int row) const
+{
+    return this->records.at(this->shown.at(row));
+}
+
+
+const QVector<int>& NFLTableModel::shownRecords() const
+{
+    return this->shown;
+}
+
+
+/*
+ * Shows the same records in a different order. :param shown: has to hold the
+ * same records that are shown now, otherwise the view is just reset.
+ */
+void NFLTableModel::reorder(const QVector<int>& shown)
+{
+    if (shown.size() != this->shown.size())
+    {
+        this->reset(shown);
+        return;
+    }
+
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+
+    // Anything the view is holding on to (like the current cell) has to follow
+    // its record to the record's new row.
+    const QModelIndexList oldIndexes = this->persistentIndexList();
+    QModelIndexList newIndexes;
+    if (!oldIndexes.isEmpty())
+    {
+        QHash<int, int> newRows;
+        newRows.reserve(shown.size());
+        for (int row = 0; row < shown.size(); row++)
+        {
+            newRows.insert(shown[row], row);
+        }
+        for (auto it = oldIndexes.cbegin(); it != oldIndexes.cend(); it++)
+        {
+            newIndexes.append(this->index(newRows.value(this->shown[it->row()]), it->column()));
+        }
+    }
+
+    this->shown = shown;
+    this->changePersistentIndexList(oldIndexes, newIndexes);
+
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+
+/*
+ * Shows a different set of records in the same order. Records that are in both
+ * the old and new lists have to be in the same order in both (they are when
+ * both lists come from the same sorted order), and the view is told which rows
+ * were taken out and put in. If they aren't, or too much changed, the view is
+ * just reset.
+ */
+void NFLTableModel::filter(const QVector<int>& shown)
+{
+    std::vector<char> inOld(this->records.size(), 0);
+    std::vector<char> inNew(this->records.size(), 0);
+
+    for (auto it = this->shown.cbegin(); it != this->shown.cend(); it++)
+    {
+        // The records were replaced, not added to.
+        if (*it >= this->records.size())
+        {
+            this->reset(shown);
+            return;
+        }
+        inOld[*it] = 1;
+    }
+    for (auto it = shown.cbegin(); it != shown.cend(); it++)
+    {
+        inNew[*it] = 1;
+    }
+
+    // Make sure the records that stay are in the same order, and count the
+    // blocks of rows that come and go.
+    int blocks = 0;
+    int oldRow = 0;
+    int newRow = 0;
+    while (oldRow < this->shown.size() || newRow < shown.size())
+    {
+        if (oldRow < this->shown.size() && !inNew[this->shown[oldRow]])
+        {
+            if (oldRow == 0 || inNew[this->shown[oldRow - 1]])
+            {
+                blocks++;
+            }
+            oldRow++;
+        }
+        else if (newRow < shown.size() && !inOld[shown[newRow]])
+        {
+            if (newRow == 0 || inOld[shown[newRow - 1]])
+            {
+                blocks++;
+            }
+            newRow++;
+        }
+        else if (oldRow < this->shown.size() && newRow < shown.size() && this->shown[oldRow] == shown[newRow])
+        {
+            oldRow++;
+            newRow++;
+        }
+        else
+        {
+            this->reset(shown);
+            return;
+        }
+    }
+
+    if (blocks > MAX_FILTER_BLOCKS)
+    {
+        this->reset(shown);
+        return;
+    }
+
+    // Take out the rows that are leaving, from the bottom up so the row
+    // numbers of the ones above don't change.
+    for (int row = this->shown.size() - 1; row >= 0;)
+    {
+        if (inNew[this->shown[row]])
+        {
+            row--;
+            continue;
+        }
+
+        const int last = row;
+        while (row >= 0 && !inNew[this->shown[row]])
+        {
+            row--;
+        }
+        this->beginRemoveRows(QModelIndex(), row + 1, last);
+        this->shown.remove(row + 1, last - row);
+        this->endRemoveRows();
+    }
+
+    // What is left is in the same order as the new list, so put the new rows
+    // in from the top down.
+    for (int row = 0; row < shown.size();)
+    {
+        if (inOld[shown[row]])
+        {
+            row++;
+            continue;
+        }
+
+        const int first = row;
+        while (row < shown.size() && !inOld[shown[row]])
+        {
+            row++;
+        }
+        this->beginInsertRows(QModelIndex(), first, row - 1);
+        this->shown.insert(first, row - first, 0);
+        for (int i = first; i < row; i++)
+        {
+            this->shown[i] = shown[i];
+        }
+        this->endInsertRows();
+    }
+}
+
+
+/*
+ * Puts new records in between the ones that are shown. :param added: holds the
+ * records in the order they go in and :param before: holds, for each of them,
+ * the row it goes in front of (counting the rows shown now, so it never goes
+ * down). The view only hears about the rows that were put in.
+ */
+void NFLTableModel::insert(const QVector<int>& added, const QVector<int>& before)
+{
+    int blocks = 0;
+    for (int i = 0; i < before.size(); i++)
+    {
+        if (i == 0 || before[i] != before[i - 1])
+        {
+            blocks++;
+        }
+    }
+
+    if (blocks > MAX_FILTER_BLOCKS)
+    {
+        QVector<int> shown;
+        shown.reserve(this->shown.size() + added.size());
+        int next = 0;
+        for (int row = 0; row <= this->shown.size(); row++)
+        {
+            while (next < added.size() && before[next] == row)
+            {
+                shown.append(added[next++]);
+            }
+            if (row < this->shown.size())
+            {
+                shown.append(this->shown[row]);
+            }
+        }
+        this->reset(shown);
+        return;
+    }
+
+    // Going from the bottom up means the rows each block goes in front of
+    // haven't moved yet.
+    for (int last = added.size() - 1; last >= 0;)
+    {
+        int first = last;
+        while (first > 0 && before[first - 1] == before[last])
+        {
+            first--;
+        }
+
+        const int row = before[last];
+        this->beginInsertRows(QModelIndex(), row, row + last - first);
+        this->shown.insert(row, last - first + 1, 0);
+        for (int i = first; i <= last; i++)
+        {
+            this->shown[row + i - first] = added[i];
+        }
+        this->endInsertRows();
+
+        last = first - 1;
+    }
+}
+
+
+/*
+ * Replaces everything that is shown. This also has to be used when the records
+ * themselves change in a way that moves them around in the table's list.
+ */
+void NFLTableModel::reset(const QVector<int>& shown)
+{
+    this->beginResetModel();
+    this->shown = shown;
+    this->endResetModel();
+}
@@ -0,0 +1,158 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    // One call of runTasks that other threads can help with.
+    struct Job
+    {
+        const std::function<void(std::size_t)>* task;
+        std::size_t tasks;
+        std::atomic<std::size_t> nextTask;
+        // How many other threads can help, and how many are.
+        std::size_t helpersWanted;
+        std::size_t helpers;
+
+        void work()
+        {
+            for (std::size_t i = this->nextTask++; i < this->tasks; i = this->nextTask++)
+            {
+                (*this->task)(i);
+            }
+        }
+    };
+
+    /*
+     * The threads that help with every runTasks call. They are started the
+     * first time they are needed and kept until the program ends, so only the
+     * first call pays for starting them. Calls from different threads share
+     * them, so running lots of calls at once doesn't start more threads than
+     * the most any one call asked for.
+     */
+    class Workers
+    {
+    public:
+        ~Workers()
+        {
+            {
+                std::lock_guard<std::mutex> locker(this->lock);
+                this->stopping = true;
+            }
+            this->wake.notify_all();
+            for (auto thread = this->threads.begin(); thread != this->threads.end(); thread++)
+            {
+                thread->join();
+            }
+        }
+
+        // Runs :param job: on this thread and up to its helpersWanted others.
+        void run(Job& job)
+        {
+            {
+                std::lock_guard<std::mutex> locker(this->lock);
+                while (this->threads.size() < job.helpersWanted)
+                {
+                    this->threads.emplace_back(&Workers::help, this);
+                }
+                this->jobs.push_back(&job);
+            }
+            this->wake.notify_all();
+
+            job.work();
+
+            // Every task has been taken, but the helpers might still be running
+            // the last of them.
+            std::unique_lock<std::mutex> locker(this->lock);
+            this->jobs.erase(std::find(this->jobs.begin(), this->jobs.end(), &job));
+            this->finished.wait(locker, [&job]() { return job.helpers == 0; });
+        }
+    private:
+        // A job that still has tasks and could use another helper, if any.
+        Job* findJob() const
+        {
+            for (auto job = this->jobs.cbegin(); job != this->jobs.cend(); job++)
+            {
+                if ((*job)->helpers < (*job)->helpersWanted && (*job)->nextTask < (*job)->tasks)
+                {
+                    return *job;
+                }
+            }
+            return nullptr;
+        }
+
+        void help()
+        {
+            std::unique_lock<std::mutex> locker(this->lock);
+            while (true)
+            {
+                Job* job = nullptr;
+                this->wake.wait(locker, [&]()
+                {
+                    job = this->findJob();
+                    return job || this->stopping;
+                });
+                if (!job)
+                {
+                    return;
+                }
+
+                job->helpers++;
+                locker.unlock();
+                job->work();
+                locker.lock();
+                if (--job->helpers == 0)
+                {
+                    this->finished.notify_all();
+                }
+            }
+        }
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        std::deque<Job*> jobs;
+        std::vector<std::thread> threads;
+        bool stopping = false;
+    };
+}
+
+
+// One thread for every core.
+std::size_t defaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+/*
+ * Runs :param task: once for every number in [0, :param tasks:) using up to
+ * :param threads: threads (including this one). Every thread takes the next
+ * task as soon as it finishes its last one, so a thread that gets a slow task
+ * doesn't hold the others up. The other threads come from a pool that lasts
+ * for the whole program. Tasks must not throw.
+ */
+void runTasks(std::size_t tasks, std::size_t threads, const std::function<void(std::size_t)>& task)
+{
+    Job job;
+    job.task = &task;
+    job.tasks = tasks;
+    job.nextTask = 0;
+    job.helpersWanted = std::min(threads, tasks) > 1 ? std::min(threads, tasks) - 1 : 0;
+    job.helpers = 0;
+
+    if (job.helpersWanted == 0)
+    {
+        job.work();
+        return;
+    }
+
+    static Workers workers;
+    workers.run(job);
+}
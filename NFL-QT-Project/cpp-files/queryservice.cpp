@@ -0,0 +1,574 @@
+#include "queryservice.h"
+#include "capacityaggregate.h"
+#include "filterexpression.h"
+#include "groupsummary.h"
+#include "searchindex.h"
+#include "sort.h"
+#include "teamquery.h"
+#include <QHash>
+#include <QList>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QRunnable>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <algorithm>
+
+
+namespace
+{
+    // The longest the line and headers of a request can be.
+    const int MAX_REQUEST_BYTES = 16 * 1024;
+
+    // How long a connection waits for the next request, or for the client to
+    // take the next part of an answer, before it is closed.
+    const int IDLE_TIMEOUT_MS = 5000;
+
+    // Once the answers kept for a set of lists add up to this many bytes, they
+    // are thrown away and kept again from scratch.
+    const int MAX_CACHE_BYTES = 64 * 1024 * 1024;
+
+    const char* reasonPhrase(int status)
+    {
+        switch (status)
+        {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        default: return "Request Header Fields Too Large";
+        }
+    }
+
+    QByteArray errorBody(const QString& message)
+    {
+        return ("{\"error\": " + jsonString(message) + "}\n").toUtf8();
+    }
+
+    QByteArray httpResponse(int status, const QByteArray& body, bool keepAlive)
+    {
+        QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + " " + reasonPhrase(status) + "\r\n";
+        response += "Content-Type: application/json; charset=utf-8\r\n";
+        response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        response += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        return response + body;
+    }
+}
+
+
+// The lists as they were when they were given to setLists, and everything
+// worked out from them while answering queries.
+struct QueryService::Dataset
+{
+    QVector<TeamRecord> originalList;
+    QVector<TeamRecord> updates;
+    QVector<const TeamRecord*> rows;
+
+    // The search index and sorted orders, filled in as they are used.
+    SelectionCache selection;
+
+    // The answers to the queries so far, keyed by Query::key.
+    QMutex cacheLock;
+    QHash<QString, QByteArray> answers;
+    int answerBytes = 0;
+};
+
+
+// What a request asked for.
+struct QueryService::Query
+{
+    // If it asked for the totals of groups of teams, not the teams.
+    bool summary = false;
+    bool onlyOriginal = false;
+    FilterExpression expression;
+    QString search;
+    QVector<SortKey> sortKeys;
+    Column groupFirst = Column::Conference;
+    int groupSecond = -1;
+    int offset = 0;
+    int limit = -1;
+
+    bool parse(const QByteArray& target, QString* error, int& status);
+    QString key() const;
+};
+
+
+/*
+ * Reads a request's :param target:, like "/teams?sort=capacity:desc". Returns
+ * false with the :param status: to answer with and an :param error: if it
+ * isn't a query the service knows how to answer.
+ */
+bool QueryService::Query::parse(const QByteArray& target, QString* error, int& status)
+{
+    // Forms send spaces as +, which QUrlQuery leaves alone.
+    QByteArray fixed = target;
+    const int question = fixed.indexOf('?');
+    if (question >= 0)
+    {
+        fixed = fixed.left(question) + fixed.mid(question).replace('+', "%20");
+    }
+    const QUrl url = QUrl::fromEncoded(fixed);
+    const QUrlQuery items(url);
+
+    status = 400;
+    if (url.path() == "/teams")
+    {
+        this->summary = false;
+    }
+    else if (url.path() == "/summary")
+    {
+        this->summary = true;
+    }
+    else
+    {
+        status = 404;
+        *error = QString("Unknown query: %1. Try /teams or /summary.").arg(url.path());
+        return false;
+    }
+
+    const QList<QPair<QString, QString>> pairs = items.queryItems(QUrl::FullyDecoded);
+    for (auto it = pairs.cbegin(); it != pairs.cend(); it++)
+    {
+        const QString& name = it->first;
+        const QString value = it->second.trimmed();
+        bool okay = true;
+
+        if (name == "filter")
+        {
+            okay = this->expression.compile(value, error);
+        }
+        else if (name == "search")
+        {
+            // Searches ignore case, so they are kept folded to share answers.
+            this->search = value.size() >= SearchIndex::MIN_LENGTH ? value.toCaseFolded() : QString();
+        }
+        else if (name == "sort" && !this->summary)
+        {
+            okay = parseSortKeys(value, this->sortKeys, error);
+        }
+        else if (name == "group" && this->summary)
+        {
+            okay = parseGroupBy(value, this->groupFirst, this->groupSecond, error);
+        }
+        else if (name == "list" && (value == "original" || value == "all"))
+        {
+            this->onlyOriginal = value == "original";
+        }
+        else if ((name == "offset" || name == "limit") && !this->summary)
+        {
+            int& number = name == "offset" ? this->offset : this->limit;
+            number = value.toInt(&okay);
+            if (!okay || number < 0)
+            {
+                *error = QString("Expected %1 to be a number that isn't negative, not %2").arg(name, value);
+                return false;
+            }
+        }
+        else
+        {
+            *error = QString("Unknown value for %1: %2=%3").arg(url.path(), name, value);
+            return false;
+        }
+
+        if (!okay)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Writes out everything that changes the answer in the same way every time,
+// so queries that only differ in how they were typed share an answer.
+QString QueryService::Query::key() const
+{
+    QStringList parts;
+    parts << (this->summary ? "summary" : "teams") << (this->onlyOriginal ? "original" : "all") << this->expression.key() << this->search;
+
+    QStringList sortParts;
+    for (auto it = this->sortKeys.cbegin(); it != this->sortKeys.cend(); it++)
+    {
+        sortParts << QString("%1:%2").arg(static_cast<int>(it->column)).arg(it->ascending ? 1 : 0);
+    }
+    parts << sortParts.join(',');
+
+    if (this->summary)
+    {
+        parts << QString("%1,%2").arg(static_cast<int>(this->groupFirst)).arg(this->groupSecond);
+    }
+    else
+    {
+        parts << QString::number(this->offset) << QString::number(this->limit);
+    }
+    return parts.join('\n');
+}
+
+
+// Reads requests from one client and sends it the answers, until it closes
+// the connection or stops sending them. It lives on the service's I/O thread
+// and is only woken up when the client sends something, so a client that
+// keeps its connection open between requests doesn't hold up a thread.
+class QueryService::Connection : public QObject
+{
+public:
+    Connection(QueryService* service, qintptr socketDescriptor, QObject* parent);
+
+    void readRequests();
+    void send(int status, const QByteArray& body, bool keepAlive);
+private:
+    QueryService* service;
+    QTcpSocket socket;
+    // Closes the connection once it has been idle for too long.
+    QTimer idleTimer;
+    // What the client has sent that hasn't been answered yet.
+    QByteArray buffer;
+    // If the answer to a request is being worked out on the pool. Requests are
+    // answered one at a time, in the order they came in.
+    bool answering;
+};
+
+
+// Works out the answer to one request on the pool, then hands it back to its
+// connection on the I/O thread to be sent.
+class QueryService::Answer : public QRunnable
+{
+public:
+    Answer(QueryService* service, Connection* connection, const QByteArray& target, bool keepAlive)
+        : service(service), connection(connection), target(target), keepAlive(keepAlive) {}
+
+    void run() override;
+private:
+    QueryService* service;
+    // Only looked at on the I/O thread, since the connection could be closed
+    // while the answer is being worked out.
+    QPointer<Connection> connection;
+    QByteArray target;
+    bool keepAlive;
+};
+
+
+QueryService::Connection::Connection(QueryService* service, qintptr socketDescriptor, QObject* parent)
+    : QObject(parent), service(service), answering(false)
+{
+    this->idleTimer.setSingleShot(true);
+    this->idleTimer.setInterval(IDLE_TIMEOUT_MS);
+    QObject::connect(&this->idleTimer, &QTimer::timeout, this, &QObject::deleteLater);
+    QObject::connect(&this->socket, &QTcpSocket::readyRead, this, &Connection::readRequests);
+    QObject::connect(&this->socket, &QTcpSocket::bytesWritten, this, [this]()
+    {
+        // A client that is slowly taking a long answer isn't idle.
+        if (!this->answering)
+        {
+            this->idleTimer.start();
+        }
+    });
+    QObject::connect(&this->socket, &QTcpSocket::disconnected, this, [this]()
+    {
+        if (!this->answering)
+        {
+            this->deleteLater();
+        }
+    });
+
+    if (!this->socket.setSocketDescriptor(socketDescriptor))
+    {
+        this->deleteLater();
+        return;
+    }
+    this->idleTimer.start();
+}
+
+
+/*
+ * Takes the line and headers of the next request out of what the client has
+ * sent and starts working out its answer on the pool. Does nothing until the
+ * whole request has come in, or while the last one is still being answered.
+ */
+void QueryService::Connection::readRequests()
+{
+    if (this->answering || this->socket.state() != QAbstractSocket::ConnectedState)
+    {
+        return;
+    }
+    if (this->service->stopping)
+    {
+        this->deleteLater();
+        return;
+    }
+
+    this->buffer += this->socket.readAll();
+    const int end = this->buffer.indexOf("\r\n\r\n");
+    if (end < 0)
+    {
+        if (this->buffer.size() > MAX_REQUEST_BYTES)
+        {
+            this->send(431, errorBody("The request's headers are too long."), false);
+        }
+        return;
+    }
+    const QByteArray head = this->buffer.left(end);
+    this->buffer.remove(0, end + 4);
+
+    // The first line is like "GET /teams HTTP/1.1", then the headers.
+    const QList<QByteArray> lines = head.split('\n');
+    const QList<QByteArray> request = lines[0].trimmed().split(' ');
+    bool keepAlive = request.size() == 3 && request[2] == "HTTP/1.1";
+    for (int i = 1; i < lines.size(); i++)
+    {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0 && lines[i].left(colon).trimmed().toLower() == "connection")
+        {
+            const QByteArray value = lines[i].mid(colon + 1).trimmed().toLower();
+            keepAlive = value == "keep-alive" || (keepAlive && value != "close");
+        }
+    }
+
+    if (request.size() != 3)
+    {
+        this->send(400, errorBody("Expected a request like GET /teams HTTP/1.1"), false);
+    }
+    else if (request[0] != "GET")
+    {
+        // Anything it sent after the headers hasn't been read, so the
+        // connection can't be used again.
+        this->send(405, errorBody("Only GET requests are answered."), false);
+    }
+    else
+    {
+        this->answering = true;
+        this->idleTimer.stop();
+        this->service->pool.start(new Answer(this->service, this, request[1], keepAlive));
+    }
+}
+
+
+/*
+ * Sends an answer with :param status: and :param body:, then reads the next
+ * request if there is one and :param keepAlive: is set, or closes the
+ * connection once the answer has been sent if it isn't.
+ */
+void QueryService::Connection::send(int status, const QByteArray& body, bool keepAlive)
+{
+    this->answering = false;
+    if (this->socket.state() != QAbstractSocket::ConnectedState)
+    {
+        this->deleteLater();
+        return;
+    }
+
+    this->socket.write(httpResponse(status, body, keepAlive));
+    this->idleTimer.start();
+    if (keepAlive)
+    {
+        this->readRequests();
+    }
+    else
+    {
+        this->socket.disconnectFromHost();
+    }
+}
+
+
+void QueryService::Answer::run()
+{
+    int status = 200;
+    const QByteArray body = this->service->respond(this->target, status);
+
+    const QPointer<Connection> connection = this->connection;
+    const bool keepAlive = this->keepAlive;
+    QMetaObject::invokeMethod(&this->service->connections, [connection, status, body, keepAlive]()
+    {
+        if (connection)
+        {
+            connection->send(status, body, keepAlive);
+        }
+    }, Qt::QueuedConnection);
+}
+
+
+QueryService::QueryService(QObject *parent) : QTcpServer(parent), stopping(false)
+{
+    this->dataset = std::make_shared<Dataset>();
+    this->connections.moveToThread(&this->ioThread);
+}
+
+
+QueryService::~QueryService()
+{
+    this->stop();
+}
+
+
+// Starts listening on localhost's :param port:. Returns false if it couldn't.
+bool QueryService::start(quint16 port)
+{
+    if (this->isListening())
+    {
+        return true;
+    }
+    this->stopping = false;
+    if (!this->ioThread.isRunning())
+    {
+        this->ioThread.start();
+    }
+    return this->listen(QHostAddress::LocalHost, port);
+}
+
+
+// Stops listening, sends the answers that are being worked out and closes the
+// connections.
+void QueryService::stop()
+{
+    this->close();
+    this->stopping = true;
+    this->pool.waitForDone();
+    if (!this->ioThread.isRunning())
+    {
+        return;
+    }
+
+    // The answers that were just worked out are waiting to be sent on the I/O
+    // thread, and are sent before this runs.
+    QMetaObject::invokeMethod(&this->connections, [this]()
+    {
+        const QObjectList open = this->connections.children();
+        qDeleteAll(open);
+    }, Qt::BlockingQueuedConnection);
+    // A connection could have started one more answer before it saw it was
+    // stopping.
+    this->pool.waitForDone();
+    this->ioThread.quit();
+    this->ioThread.wait();
+}
+
+
+/*
+ * Answers queries from :param originalList: and :param updates: from now on.
+ * The lists are shared with the caller, and the queries that are already
+ * running finish with the old ones.
+ */
+void QueryService::setLists(const QVector<TeamRecord>& originalList, const QVector<TeamRecord>& updates)
+{
+    auto next = std::make_shared<Dataset>();
+    next->originalList = originalList;
+    next->updates = updates;
+    next->rows.reserve(originalList.size() + updates.size());
+    for (auto it = next->originalList.cbegin(); it != next->originalList.cend(); it++)
+    {
+        next->rows.push_back(&*it);
+    }
+    for (auto it = next->updates.cbegin(); it != next->updates.cend(); it++)
+    {
+        next->rows.push_back(&*it);
+    }
+
+    QMutexLocker locker(&this->datasetLock);
+    this->dataset = next;
+}
+
+
+std::shared_ptr<QueryService::Dataset> QueryService::currentDataset() const
+{
+    QMutexLocker locker(&this->datasetLock);
+    return this->dataset;
+}
+
+
+/*
+ * Answers the query in :param target: (the path and query of a URL) with
+ * JSON, setting :param status: to the HTTP status to send it with. This is
+ * called from the pool's threads, and can be called from any number of them
+ * at once.
+ */
+QByteArray QueryService::respond(const QByteArray& target, int& status)
+{
+    Query query;
+    QString error;
+    if (!query.parse(target, &error, status))
+    {
+        return errorBody(error);
+    }
+    status = 200;
+
+    const std::shared_ptr<Dataset> dataset = this->currentDataset();
+    const QString key = query.key();
+    {
+        QMutexLocker locker(&dataset->cacheLock);
+        auto found = dataset->answers.constFind(key);
+        if (found != dataset->answers.constEnd())
+        {
+            return found.value();
+        }
+    }
+
+    QVector<const TeamRecord*> selected;
+    const int count = query.onlyOriginal ? dataset->originalList.size() : dataset->rows.size();
+    selectRows(dataset->rows, query.expression, query.search, query.sortKeys, count, selected, &dataset->selection);
+
+    QString body;
+    if (query.summary)
+    {
+        GroupSummary summary(query.groupFirst, query.groupSecond);
+        QVector<GroupTotals> groups;
+        summary.update(selected);
+        summary.groups(groups);
+
+        const QStringList names = groupFieldNames(query.groupFirst, query.groupSecond);
+        QStringList objects;
+        for (auto it = groups.cbegin(); it != groups.cend(); it++)
+        {
+            QueryRow row;
+            groupFields(*it, query.groupSecond, row);
+            objects.append(jsonObject(names, row));
+        }
+        body = "{\"groups\": [" + objects.join(", ") + "]}\n";
+    }
+    else
+    {
+        CapacityAggregate capacity;
+        for (auto it = selected.cbegin(); it != selected.cend(); it++)
+        {
+            capacity.add(**it);
+        }
+
+        const QStringList names = teamFieldNames();
+        const int first = std::min(query.offset, selected.size());
+        const int last = query.limit < 0 ? selected.size() : first + std::min(query.limit, selected.size() - first);
+        QStringList objects;
+        for (int i = first; i < last; i++)
+        {
+            QueryRow row;
+            teamFields(*selected[i], row);
+            objects.append(jsonObject(names, row));
+        }
+        body = QString("{\"count\": %1, \"totalCapacity\": %2, \"teams\": [").arg(selected.size()).arg(capacity.total()) + objects.join(", ") + "]}\n";
+    }
+
+    const QByteArray answer = body.toUtf8();
+    QMutexLocker locker(&dataset->cacheLock);
+    if (dataset->answerBytes + answer.size() > MAX_CACHE_BYTES)
+    {
+        dataset->answers.clear();
+        dataset->answerBytes = 0;
+    }
+    if (!dataset->answers.contains(key))
+    {
+        dataset->answers.insert(key, answer);
+        dataset->answerBytes += answer.size();
+    }
+    return answer;
+}
+
+
+// Hands each new connection to the I/O thread.
+void QueryService::incomingConnection(qintptr socketDescriptor)
+{
+    QMetaObject::invokeMethod(&this->connections, [this, socketDescriptor]()
+    {
+        new Connection(this, socketDescriptor, &this->connections);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,934 @@
+#include "searchindex.h"
+#include "parallel.h"
+#include <QPair>
+#include <algorithm>
+#include <chrono>
+
+
+namespace
+{
+    // The columns that are searched, in the order their matches are ranked.
+    const Column TEXT_COLUMNS[] = {Column::TeamName, Column::StadiumName, Column::City, Column::State};
+    const int TEXT_COUNT = 4;
+    const Column ENCODED_COLUMNS[] = {Column::Conference, Column::Division, Column::SurfaceType, Column::RoofType};
+    const int ENCODED_COUNT = 4;
+
+    // Where each of TEXT_COLUMNS and ENCODED_COLUMNS is in a TeamRecord.
+    const QString TeamRecord::* const TEXT_MEMBERS[] = {
+        ColumnTraits<Column::TeamName>::member,
+        ColumnTraits<Column::StadiumName>::member,
+        ColumnTraits<Column::City>::member,
+        ColumnTraits<Column::State>::member
+    };
+    DictionaryCode TeamRecord::* const ENCODED_MEMBERS[] = {
+        ColumnTraits<Column::Conference>::member,
+        ColumnTraits<Column::Division>::member,
+        ColumnTraits<Column::SurfaceType>::member,
+        ColumnTraits<Column::RoofType>::member
+    };
+
+    // The most edits a search is ever allowed, see SearchIndex::allowedEdits.
+    const int MAX_EDITS = 2;
+
+    // Searches longer than this are only matched exactly, which lets the
+    // edits be worked out with a bit for each letter of the search.
+    const int MAX_FUZZY_LENGTH = 64;
+
+    // Every posting holds a row and a bit for each of TEXT_COLUMNS.
+    const int FIELD_BITS = 4;
+    const quint8 ALL_FIELDS = (1 << FIELD_BITS) - 1;
+
+    // When more than one in this many rows were counted, going through all of
+    // them is quicker than sorting the ones that were.
+    const std::size_t TOUCHED_SORT_FRACTION = 16;
+
+    // How many rows are indexed between checks for being cancelled.
+    const int CANCEL_CHECK_ROWS = 4096;
+
+    quint64 trigram(const QChar* letters)
+    {
+        return (static_cast<quint64>(letters[0].unicode()) << 32) | (static_cast<quint64>(letters[1].unicode()) << 16) | letters[2].unicode();
+    }
+
+    // Adds every trigram of the :param size: letters at :param text: (which
+    // have to be case folded already) to :param out:. Each one is shifted up to
+    // make room for :param field: in the bottom bits.
+    void addTrigrams(const QChar* text, std::size_t size, std::vector<quint64>& out, quint64 field = 0)
+    {
+        for (std::size_t i = 0; i + 2 < size; i++)
+        {
+            out.push_back(trigram(text + i) << FIELD_BITS | field);
+        }
+    }
+
+    // The row a posting is for, and which of the text columns have the
+    // trigram, as bits in the order of TEXT_COLUMNS.
+    inline int postingRow(quint32 posting)
+    {
+        return static_cast<int>(posting >> FIELD_BITS);
+    }
+    inline quint8 postingFields(quint32 posting)
+    {
+        return posting & ALL_FIELDS;
+    }
+
+    /*
+     * Finds the first of the items from :param from: to :param to: (in order of
+     * their rows, which :param rowOf: gets) whose row isn't before :param row:.
+     * Items further on by a step that doubles each time are checked before
+     * searching between the last two, so going through two lists side by side
+     * only costs about as much as the gaps between them.
+     */
+    template<typename Iterator, typename RowOf>
+    Iterator skipTo(Iterator from, Iterator to, int row, RowOf rowOf)
+    {
+        std::size_t step = 1;
+        while (static_cast<std::size_t>(to - from) > step && rowOf(from[step]) < row)
+        {
+            from += step;
+            step *= 2;
+        }
+        const Iterator end = static_cast<std::size_t>(to - from) > step ? from + step + 1 : to;
+        return std::lower_bound(from, end, row, [&](const typename std::iterator_traits<Iterator>::value_type& item, int value)
+        {
+            return rowOf(item) < value;
+        });
+    }
+}
+
+
+// What is being searched for, worked out once per search.
+struct SearchIndex::Query
+{
+    // The search text, case folded.
+    QString text;
+    int edits;
+    // If the search is a single trigram, the postings already say exactly
+    // which text columns have it, so they don't need to be checked.
+    bool singleTrigram;
+    // For each of the encoded columns, how far each code's text is from the
+    // search text.
+    std::vector<int> codeDistances[COLUMN_COUNT];
+    // For each letter, a bit for every place in the search text it is at.
+    // The letters past the first 256 are looked up in others.
+    quint64 latinMasks[256];
+    QVector<QPair<QChar, quint64>> otherMasks;
+
+    Query(const QString& text, int edits) : text(text), edits(edits), singleTrigram(text.size() == 3)
+    {
+        std::fill(std::begin(this->latinMasks), std::end(this->latinMasks), 0);
+        for (int i = 0; i < text.size() && i < MAX_FUZZY_LENGTH; i++)
+        {
+            const quint64 bit = static_cast<quint64>(1) << i;
+            if (text[i].unicode() < 256)
+            {
+                this->latinMasks[text[i].unicode()] |= bit;
+                continue;
+            }
+            auto found = std::find_if(this->otherMasks.begin(), this->otherMasks.end(), [&](const QPair<QChar, quint64>& mask)
+            {
+                return mask.first == text[i];
+            });
+            if (found == this->otherMasks.end())
+            {
+                this->otherMasks.push_back(qMakePair(text[i], bit));
+            }
+            else
+            {
+                found->second |= bit;
+            }
+        }
+
+        for (auto column = std::begin(ENCODED_COLUMNS); column != std::end(ENCODED_COLUMNS); column++)
+        {
+            const Dictionary& dictionary = columnDictionary(*column);
+            std::vector<int>& distances = this->codeDistances[static_cast<int>(*column)];
+
+            distances.resize(dictionary.size());
+            for (int code = 0; code < dictionary.size(); code++)
+            {
+                const QString value = dictionary.text(static_cast<DictionaryCode>(code)).toCaseFolded();
+                distances[code] = this->distance(value.constData(), value.size());
+            }
+        }
+    }
+
+    quint64 mask(QChar letter) const
+    {
+        if (letter.unicode() < 256)
+        {
+            return this->latinMasks[letter.unicode()];
+        }
+        for (auto it = this->otherMasks.cbegin(); it != this->otherMasks.cend(); it++)
+        {
+            if (it->first == letter)
+            {
+                return it->second;
+            }
+        }
+        return 0;
+    }
+
+    /*
+     * Works out the fewest edits that turn the search text into any part of
+     * the :param size: letters at :param value: (which have to be case folded
+     * already), or edits + 1 if it is more than that.
+     *
+     * When edits are allowed this is Myers' bit-parallel way of filling in
+     * the usual table of edits, with a row for each letter of the search and a
+     * column for each letter of the value. Only whether each cell is one more,
+     * one less or the same as the one above it is kept, as a bit for each row,
+     * so a whole column is worked out at once with a few operations on those
+     * bits. Any part of the value can be the start of the match, so the top of
+     * every column is 0.
+     */
+    int distance(const QChar* value, std::size_t size) const
+    {
+        const int length = this->text.size();
+        if (this->edits == 0 || length > MAX_FUZZY_LENGTH)
+        {
+            return std::search(value, value + size, this->text.constData(), this->text.constData() + length) != value + size ? 0 : 1;
+        }
+
+        const quint64 bottom = static_cast<quint64>(1) << (length - 1);
+        quint64 up = ~static_cast<quint64>(0);
+        quint64 down = 0;
+        int distance = length;
+        int best = length;
+        for (std::size_t j = 0; j < size && best > 0; j++)
+        {
+            const quint64 equal = this->mask(value[j]);
+            const quint64 vertical = equal | down;
+            const quint64 horizontal = (((equal & up) + up) ^ up) | equal;
+            quint64 rightUp = down | ~(horizontal | up);
+            quint64 rightDown = up & horizontal;
+            if (rightUp & bottom)
+            {
+                distance++;
+            }
+            else if (rightDown & bottom)
+            {
+                distance--;
+            }
+            rightUp <<= 1;
+            rightDown <<= 1;
+            up = rightDown | ~(vertical | rightUp);
+            down = rightUp & vertical;
+            best = std::min(best, distance);
+        }
+        return std::min(best, this->edits + 1);
+    }
+
+    /*
+     * Checks if :param row: matches, filling in :param out: if it does. Its
+     * text columns are the letters between each of :param starts: and the next,
+     * and its encoded columns are in :param codes:, in the orders of
+     * TEXT_COLUMNS and ENCODED_COLUMNS. Only the text columns in :param fields:
+     * (bits in the order of TEXT_COLUMNS) could match, the rest are skipped.
+     * The ones that do match are put in :param matched:, the same way.
+     */
+    bool match(const QChar* letters, const quint64* starts, const DictionaryCode* codes, int row, quint8 fields, SearchMatch& out, quint8& matched) const
+    {
+        out.row = row;
+        out.distance = this->edits + 1;
+        matched = 0;
+
+        if (this->singleTrigram && fields != 0)
+        {
+            int first = 0;
+            while (!(fields & (1 << first)))
+            {
+                first++;
+            }
+            out.distance = 0;
+            out.column = TEXT_COLUMNS[first];
+            matched = fields;
+            return true;
+        }
+
+        for (int i = 0; i < TEXT_COUNT; i++)
+        {
+            if (!(fields & (1 << i)))
+            {
+                continue;
+            }
+            const int distance = this->distance(letters + starts[i], starts[i + 1] - starts[i]);
+            if (distance <= this->edits)
+            {
+                matched |= 1 << i;
+            }
+            if (distance < out.distance)
+            {
+                out.distance = distance;
+                out.column = TEXT_COLUMNS[i];
+            }
+        }
+        for (int i = 0; i < ENCODED_COUNT && out.distance > 0; i++)
+        {
+            const int distance = this->codeDistances[static_cast<int>(ENCODED_COLUMNS[i])][codes[i]];
+            if (distance < out.distance)
+            {
+                out.distance = distance;
+                out.column = ENCODED_COLUMNS[i];
+            }
+        }
+        return out.distance <= this->edits;
+    }
+};
+
+
+SearchIndex::SearchIndex() : starts(1, 0), cancelled(false)
+{
+    this->rowCount = 0;
+    this->indexing = false;
+    this->addedCount = 0;
+    this->searchedRows = 0;
+    this->wider.edits = 0;
+}
+
+
+// The threads indexing and searching in the background have to stop before
+// anything they use goes away.
+SearchIndex::~SearchIndex()
+{
+    this->cancelled = true;
+    this->finishIndexing();
+    this->finishWidening();
+}
+
+
+/*
+ * Adds the rows from :param first: to the end of :param rows: to the end of
+ * the index. Their text is copied straight away and they are indexed on another
+ * thread, which the next search waits for if it hasn't finished.
+ */
+void SearchIndex::add(const QVector<const TeamRecord*>& rows, int first)
+{
+    if (first >= rows.size())
+    {
+        return;
+    }
+
+    // The rows are about to go into the index that is being searched in the
+    // background.
+    this->finishWidening();
+
+    std::lock_guard<std::mutex> locker(this->addedLock);
+    this->addedText.reserve(this->addedText.size() + static_cast<std::size_t>(rows.size() - first) * TEXT_COUNT);
+    this->addedCodes.reserve(this->addedCodes.size() + static_cast<std::size_t>(rows.size() - first) * ENCODED_COUNT);
+    for (int row = first; row < rows.size(); row++)
+    {
+        for (int i = 0; i < TEXT_COUNT; i++)
+        {
+            this->addedText.push_back(rows[row]->*TEXT_MEMBERS[i]);
+        }
+        for (int i = 0; i < ENCODED_COUNT; i++)
+        {
+            this->addedCodes.push_back(rows[row]->*ENCODED_MEMBERS[i]);
+        }
+    }
+    this->addedCount += rows.size() - first;
+
+    if (!this->indexing)
+    {
+        this->indexing = true;
+        this->indexer = std::async(std::launch::async, &SearchIndex::indexAdded, this);
+    }
+}
+
+
+// How many rows have been added.
+int SearchIndex::size() const
+{
+    return this->addedCount;
+}
+
+
+/*
+ * Finds the rows that match :param text:, best first. Rows that have the text
+ * in them come first, then the ones that are one edit away and so on. Ties are
+ * ranked by which column matched (the team name first) and then by the order
+ * the rows were added in. Text shorter than MIN_LENGTH doesn't match anything.
+ */
+const QVector<SearchMatch>& SearchIndex::search(const QString& text)
+{
+    this->finishIndexing();
+    if (this->searchedRows != this->rowCount)
+    {
+        // The old results don't know about the new rows.
+        this->history.clear();
+        this->wider = Result();
+        this->wider.edits = 0;
+        this->searchedRows = this->rowCount;
+        this->counts.assign(static_cast<std::size_t>(this->rowCount) * TEXT_COUNT, 0);
+    }
+
+    const QString folded = text.toCaseFolded();
+    if (folded.size() < MIN_LENGTH)
+    {
+        this->history.clear();
+        this->ranked.clear();
+        return this->ranked;
+    }
+
+    while (!this->history.isEmpty() && !folded.startsWith(this->history.back().text))
+    {
+        this->history.pop_back();
+    }
+
+    if (this->history.isEmpty() || this->history.back().text != folded)
+    {
+        Result result;
+        const Query query(folded, allowedEdits(folded.size()));
+        result.text = folded;
+        result.edits = query.edits;
+
+        // Text added to the end of the last search can't match any row that
+        // the last search didn't, as long as it allows as many edits. The
+        // search worked out in the background allows the edits this one does.
+        const Result* last = nullptr;
+        if (!this->history.isEmpty() && this->history.back().edits == query.edits)
+        {
+            last = &this->history.back();
+        }
+        else if (!this->wider.text.isEmpty() && this->wider.edits == query.edits && folded.startsWith(this->wider.text))
+        {
+            this->finishWidening();
+            last = &this->wider;
+        }
+
+        this->match(query, last, this->counts, result);
+        this->history.push_back(result);
+    }
+
+    const Result& current = this->history.back();
+    const QVector<SearchMatch>& matches = current.matches;
+
+    // There are only a few different ranks, so the matches are put straight
+    // into place by counting how many there are of each.
+    int starts[(MAX_EDITS + 1) * COLUMN_COUNT + 1] = {};
+    for (auto it = matches.cbegin(); it != matches.cend(); it++)
+    {
+        starts[it->distance * COLUMN_COUNT + static_cast<int>(it->column) + 1]++;
+    }
+    for (int rank = 1; rank <= (MAX_EDITS + 1) * COLUMN_COUNT; rank++)
+    {
+        starts[rank] += starts[rank - 1];
+    }
+    this->ranked.resize(matches.size());
+    for (auto it = matches.cbegin(); it != matches.cend(); it++)
+    {
+        this->ranked[starts[it->distance * COLUMN_COUNT + static_cast<int>(it->column)]++] = *it;
+    }
+
+    // When the next letter allows more edits, the rows that can match this
+    // text with that many are found while waiting for it. If the last one is
+    // still going it is left to finish instead.
+    const int nextEdits = allowedEdits(current.text.size() + 1);
+    if (nextEdits > current.edits && (this->wider.text != current.text || this->wider.edits != nextEdits)
+        && (!this->widener.valid() || this->widener.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+    {
+        this->widen(current.text, nextEdits);
+    }
+
+    return this->ranked;
+}
+
+
+// Forgets every row, for when rows were changed or taken away.
+void SearchIndex::clear()
+{
+    this->cancelled = true;
+    this->finishIndexing();
+    this->finishWidening();
+    this->cancelled = false;
+
+    this->addedText.clear();
+    this->addedCodes.clear();
+    this->addedCount = 0;
+    this->letters.clear();
+    this->starts.assign(1, 0);
+    this->codes.clear();
+    this->postings.clear();
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        this->codeRows[column].clear();
+    }
+    this->rowCount = 0;
+    this->history.clear();
+    this->searchedRows = 0;
+    this->ranked.clear();
+    this->counts.clear();
+    this->wider = Result();
+    this->wider.edits = 0;
+    this->widerCounts.clear();
+}
+
+
+/*
+ * Works out how many edits a search of :param length: letters can be off by.
+ * Each edit can break three of the search's trigrams, so only searches with
+ * enough trigrams that a match still has to share a few of them are allowed
+ * any. Otherwise nearly every row would have to be checked.
+ */
+int SearchIndex::allowedEdits(int length)
+{
+    if (length > MAX_FUZZY_LENGTH)
+    {
+        return 0;
+    }
+    if (length >= 12)
+    {
+        return MAX_EDITS;
+    }
+    return length >= 8 ? 1 : 0;
+}
+
+
+// Runs on its own thread, indexing the rows that were added until there are no
+// more left or it is cancelled.
+void SearchIndex::indexAdded()
+{
+    std::vector<QString> text;
+    std::vector<DictionaryCode> codes;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> locker(this->addedLock);
+            text.clear();
+            codes.clear();
+            if (this->addedText.empty() || this->cancelled)
+            {
+                this->indexing = false;
+                return;
+            }
+            text.swap(this->addedText);
+            codes.swap(this->addedCodes);
+        }
+        this->index(text, codes);
+    }
+}
+
+
+/*
+ * Adds the rows in :param text: and :param codes: (laid out like addedText and
+ * addedCodes) to the end of the index.
+ */
+void SearchIndex::index(std::vector<QString>& text, std::vector<DictionaryCode>& codes)
+{
+    const int added = static_cast<int>(text.size() / TEXT_COUNT);
+    std::vector<quint64> trigrams;
+    for (int i = 0; i < added; i++)
+    {
+        if (i % CANCEL_CHECK_ROWS == 0 && this->cancelled)
+        {
+            return;
+        }
+
+        const int row = this->rowCount + i;
+        trigrams.clear();
+        for (int j = 0; j < TEXT_COUNT; j++)
+        {
+            const QString& value = text[static_cast<std::size_t>(i) * TEXT_COUNT + j];
+            const std::size_t start = this->letters.size();
+            for (int k = 0; k < value.size(); k++)
+            {
+                this->letters.push_back(value[k].toCaseFolded());
+            }
+            this->starts.push_back(this->letters.size());
+            addTrigrams(this->letters.data() + start, this->letters.size() - start, trigrams, 1 << j);
+        }
+        std::sort(trigrams.begin(), trigrams.end());
+
+        // Each row only goes in the list for each trigram once, with a bit
+        // set for every column that has it.
+        for (std::size_t j = 0; j < trigrams.size();)
+        {
+            const quint64 key = trigrams[j] >> FIELD_BITS;
+            quint32 posting = static_cast<quint32>(row) << FIELD_BITS;
+            for (; j < trigrams.size() && trigrams[j] >> FIELD_BITS == key; j++)
+            {
+                posting |= trigrams[j] & ALL_FIELDS;
+            }
+            this->postings[key].push_back(posting);
+        }
+
+        for (int j = 0; j < ENCODED_COUNT; j++)
+        {
+            std::vector<std::vector<int>>& byCode = this->codeRows[static_cast<int>(ENCODED_COLUMNS[j])];
+            const DictionaryCode code = codes[static_cast<std::size_t>(i) * ENCODED_COUNT + j];
+            if (code >= byCode.size())
+            {
+                byCode.resize(code + 1);
+            }
+            byCode[code].push_back(row);
+        }
+    }
+
+    this->codes.insert(this->codes.end(), codes.begin(), codes.end());
+    this->rowCount += added;
+}
+
+
+// Waits for every row that was added to be indexed.
+void SearchIndex::finishIndexing()
+{
+    if (this->indexer.valid())
+    {
+        this->indexer.wait();
+    }
+}
+
+
+// Starts finding the rows that match :param text: with :param edits: on
+// another thread, putting them in wider.
+void SearchIndex::widen(const QString& text, int edits)
+{
+    this->finishWidening();
+    this->wider.text = text;
+    this->wider.edits = edits;
+    this->wider.matches.clear();
+    this->wider.fields.clear();
+    this->widerCounts.resize(this->counts.size(), 0);
+
+    this->widener = std::async(std::launch::async, [this]()
+    {
+        const Query query(this->wider.text, this->wider.edits);
+        this->match(query, nullptr, this->widerCounts, this->wider);
+    });
+}
+
+
+// Waits for the search being worked out in the background, if there is one.
+void SearchIndex::finishWidening()
+{
+    if (this->widener.valid())
+    {
+        this->widener.wait();
+    }
+}
+
+
+// Puts the rows that match :param query: in :param out:, in order, only
+// looking at the rows that matched :param last: if there is one. :param counts:
+// has to be all 0s, with room for every text column of every row.
+void SearchIndex::match(const Query& query, const Result* last, std::vector<quint8>& counts, Result& out) const
+{
+    std::vector<Candidate> checking;
+    this->candidates(query, last, counts, checking);
+    this->verify(query, checking, out);
+}
+
+
+
+
+/*
+ * Gets the rows that could match :param query:, in order, along with which of
+ * their text columns could. A column can only match with n edits if it shares
+ * all but 3n of the search's trigrams. A row can also match through one of its
+ * encoded columns. When this search can be narrowed down from :param last:, only
+ * the text columns that matched it can match, so only its rows are looked at
+ * unless every trigram is needed and one of them has fewer rows. :param counts:
+ * is used to count the trigrams of each row, and is left all 0s again.
+ */
+void SearchIndex::candidates(const Query& query, const Result* last, std::vector<quint8>& counts, std::vector<Candidate>& out) const
+{
+    out.clear();
+
+    std::vector<quint64> trigrams;
+    addTrigrams(query.text.constData(), query.text.size(), trigrams);
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    // Find the rows of each trigram, the fewest first.
+    static const std::vector<quint32> none;
+    std::vector<const std::vector<quint32>*> lists;
+    for (auto it = trigrams.cbegin(); it != trigrams.cend(); it++)
+    {
+        auto found = this->postings.constFind(*it >> FIELD_BITS);
+        lists.push_back(found == this->postings.constEnd() ? &none : &found.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const std::vector<quint32>* first, const std::vector<quint32>* second)
+    {
+        return first->size() < second->size();
+    });
+
+    const int needed = static_cast<int>(trigrams.size()) - 3 * query.edits;
+
+    // Checking a row for the search text itself costs about as much as
+    // looking it up in the index, so when no edits are allowed the rows the
+    // last search matched are just checked again if there are fewer of them
+    // than the rows of any trigram.
+    if (last && (needed < 1 || (query.edits == 0 && last->fields.size() < lists.front()->size())))
+    {
+        out.reserve(last->fields.size());
+        for (int i = 0; i < last->matches.size(); i++)
+        {
+            out.push_back(Candidate{last->matches[i].row, last->fields[i]});
+        }
+        return;
+    }
+
+    if (needed < 1)
+    {
+        // Repeated letters can leave too few trigrams to rule any row out.
+        out.resize(this->rowCount);
+        for (int row = 0; row < this->rowCount; row++)
+        {
+            out[row] = Candidate{row, ALL_FIELDS};
+        }
+        return;
+    }
+
+    if (needed == static_cast<int>(lists.size()) && (!last || lists.front()->size() <= last->fields.size()))
+    {
+        // Every trigram is needed, so go through the shortest list and look
+        // each row up in the others, keeping the columns that have them all.
+        std::vector<std::vector<quint32>::const_iterator> from;
+        for (auto list = lists.cbegin(); list != lists.cend(); list++)
+        {
+            from.push_back((*list)->cbegin());
+        }
+        for (auto posting = lists.front()->cbegin(); posting != lists.front()->cend(); posting++)
+        {
+            const int row = postingRow(*posting);
+            quint8 fields = postingFields(*posting);
+            for (std::size_t i = 1; i < lists.size() && fields != 0; i++)
+            {
+                from[i] = skipTo(from[i], lists[i]->cend(), row, postingRow);
+                fields &= (from[i] != lists[i]->cend() && postingRow(*from[i]) == row) ? postingFields(*from[i]) : 0;
+            }
+            if (fields != 0)
+            {
+                out.push_back(Candidate{row, fields});
+            }
+        }
+
+        // Anything the last search didn't match can't match this one either.
+        if (last)
+        {
+            std::size_t kept = 0;
+            int previous = 0;
+            for (auto it = out.cbegin(); it != out.cend(); it++)
+            {
+                while (previous < last->matches.size() && last->matches[previous].row < it->row)
+                {
+                    previous++;
+                }
+                if (previous < last->matches.size() && last->matches[previous].row == it->row && (it->fields & last->fields[previous]))
+                {
+                    out[kept++] = Candidate{it->row, static_cast<quint8>(it->fields & last->fields[previous])};
+                }
+            }
+            out.resize(kept);
+        }
+    }
+    else if (last)
+    {
+        // Only the rows the last search matched can match, so the trigrams are
+        // only counted for them, going through each list alongside them.
+        auto matchRow = [](const SearchMatch& match)
+        {
+            return match.row;
+        };
+        const QVector<SearchMatch>& matches = last->matches;
+        std::vector<quint8> lastCounts(last->fields.size() * TEXT_COUNT, 0);
+        for (auto list = lists.cbegin(); list != lists.cend(); list++)
+        {
+            auto match = matches.cbegin();
+            auto posting = (*list)->cbegin();
+            while (match != matches.cend() && posting != (*list)->cend())
+            {
+                if (match->row < postingRow(*posting))
+                {
+                    match = skipTo(match, matches.cend(), postingRow(*posting), matchRow);
+                }
+                else if (postingRow(*posting) < match->row)
+                {
+                    posting = skipTo(posting, (*list)->cend(), match->row, postingRow);
+                }
+                else
+                {
+                    quint8* rowCounts = &lastCounts[static_cast<std::size_t>(match - matches.cbegin()) * TEXT_COUNT];
+                    for (int i = 0; i < TEXT_COUNT; i++)
+                    {
+                        rowCounts[i] += (postingFields(*posting) >> i) & 1;
+                    }
+                    match++;
+                    posting++;
+                }
+            }
+        }
+
+        for (int i = 0; i < matches.size(); i++)
+        {
+            const quint8* rowCounts = &lastCounts[static_cast<std::size_t>(i) * TEXT_COUNT];
+            quint8 fields = 0;
+            for (int j = 0; j < TEXT_COUNT; j++)
+            {
+                if (rowCounts[j] >= needed)
+                {
+                    fields |= 1 << j;
+                }
+            }
+            fields &= last->fields[i];
+            if (fields != 0)
+            {
+                out.push_back(Candidate{matches[i].row, fields});
+            }
+        }
+    }
+    else
+    {
+        // Count the trigrams each column of each row has, only keeping the
+        // columns that reach the number needed. The counts are put back to 0
+        // for next time as they go.
+        std::vector<int> touched;
+        for (auto list = lists.cbegin(); list != lists.cend(); list++)
+        {
+            for (auto posting = (*list)->cbegin(); posting != (*list)->cend(); posting++)
+            {
+                const int row = postingRow(*posting);
+                const quint8 fields = postingFields(*posting);
+                quint8* rowCounts = &counts[static_cast<std::size_t>(row) * TEXT_COUNT];
+                if (!(rowCounts[0] | rowCounts[1] | rowCounts[2] | rowCounts[3]))
+                {
+                    touched.push_back(row);
+                }
+                for (int i = 0; i < TEXT_COUNT; i++)
+                {
+                    rowCounts[i] += (fields >> i) & 1;
+                }
+            }
+        }
+
+        // The rows have to come out in order. When a lot of them were
+        // touched it is quicker to go through every row than to sort them.
+        if (touched.size() * TOUCHED_SORT_FRACTION < static_cast<std::size_t>(this->rowCount))
+        {
+            std::sort(touched.begin(), touched.end());
+        }
+        else
+        {
+            touched.clear();
+            for (int row = 0; row < this->rowCount; row++)
+            {
+                const quint8* rowCounts = &counts[static_cast<std::size_t>(row) * TEXT_COUNT];
+                if (rowCounts[0] | rowCounts[1] | rowCounts[2] | rowCounts[3])
+                {
+                    touched.push_back(row);
+                }
+            }
+        }
+
+        for (auto it = touched.cbegin(); it != touched.cend(); it++)
+        {
+            quint8* rowCounts = &counts[static_cast<std::size_t>(*it) * TEXT_COUNT];
+            quint8 fields = 0;
+            for (int i = 0; i < TEXT_COUNT; i++)
+            {
+                if (rowCounts[i] >= needed)
+                {
+                    fields |= 1 << i;
+                }
+                rowCounts[i] = 0;
+            }
+            if (fields != 0)
+            {
+                out.push_back(Candidate{*it, fields});
+            }
+        }
+    }
+
+    // The rows that can match through one of their encoded columns are
+    // checked too, without any of their text columns if they weren't found
+    // above. The rows of each code are already in order, so each code's rows
+    // are merged in with the ones before them.
+    auto byRow = [](const Candidate& first, const Candidate& second)
+    {
+        return first.row < second.row;
+    };
+    std::vector<Candidate> encoded;
+    for (auto column = std::begin(ENCODED_COLUMNS); column != std::end(ENCODED_COLUMNS); column++)
+    {
+        const std::vector<int>& distances = query.codeDistances[static_cast<int>(*column)];
+        const std::vector<std::vector<int>>& byCode = this->codeRows[static_cast<int>(*column)];
+        for (std::size_t code = 0; code < byCode.size() && code < distances.size(); code++)
+        {
+            if (distances[code] <= query.edits)
+            {
+                const std::size_t before = encoded.size();
+                for (auto row = byCode[code].cbegin(); row != byCode[code].cend(); row++)
+                {
+                    encoded.push_back(Candidate{*row, 0});
+                }
+                std::inplace_merge(encoded.begin(), encoded.begin() + before, encoded.end(), byRow);
+            }
+        }
+    }
+    if (encoded.empty())
+    {
+        return;
+    }
+
+    std::vector<Candidate> merged;
+    merged.reserve(out.size() + encoded.size());
+    std::merge(out.begin(), out.end(), encoded.begin(), encoded.end(), std::back_inserter(merged), byRow);
+
+    // Put each row in once, with every column it was found for.
+    out.clear();
+    for (auto it = merged.cbegin(); it != merged.cend(); it++)
+    {
+        if (!out.empty() && out.back().row == it->row)
+        {
+            out.back().fields |= it->fields;
+        }
+        else
+        {
+            out.push_back(*it);
+        }
+    }
+}
+
+
+// Checks each of the :param candidates: against :param query:, putting the ones
+// that match in the matches and fields of :param out:, in the same order.
+void SearchIndex::verify(const Query& query, const std::vector<Candidate>& candidates, Result& out) const
+{
+    const std::size_t parts = candidates.size() < static_cast<std::size_t>(PARALLEL_MIN_ROWS) ? 1 : defaultThreadCount();
+    std::vector<QVector<SearchMatch>> found(parts);
+    std::vector<std::vector<quint8>> foundFields(parts);
+
+    runTasks(parts, parts, [&](std::size_t part)
+    {
+        const std::size_t from = candidates.size() * part / parts;
+        const std::size_t to = candidates.size() * (part + 1) / parts;
+        SearchMatch match;
+        quint8 matched;
+        found[part].reserve(static_cast<int>(to - from));
+        foundFields[part].reserve(to - from);
+        for (std::size_t i = from; i < to; i++)
+        {
+            const std::size_t row = static_cast<std::size_t>(candidates[i].row);
+            if (query.match(this->letters.data(), &this->starts[row * TEXT_COUNT], &this->codes[row * ENCODED_COUNT], candidates[i].row, candidates[i].fields, match, matched))
+            {
+                found[part].push_back(match);
+                foundFields[part].push_back(matched);
+            }
+        }
+    });
+
+    if (parts == 1)
+    {
+        out.matches.swap(found.front());
+        out.fields.swap(foundFields.front());
+        return;
+    }
+    out.matches.clear();
+    out.fields.clear();
+    for (std::size_t part = 0; part < parts; part++)
+    {
+        out.matches.append(found[part]);
+        out.fields.insert(out.fields.end(), foundFields[part].begin(), foundFields[part].end());
+    }
+}
@@ -0,0 +1,497 @@
+#include "snapshot.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLocale>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include "csv.h"
+#include "mappedfile.h"
+
+
+namespace
+{
+    // Change the version whenever the layout of a snapshot or of TeamRecord
+    // changes, so old snapshots are ignored instead of being misread.
+    const char SNAPSHOT_MAGIC[8] = {'N', 'F', 'L', 'S', 'N', 'A', 'P', '\0'};
+    const quint32 SNAPSHOT_VERSION = 2;
+    // Reads back as a different number on a computer that stores numbers the
+    // other way around, which couldn't use the arrays in place.
+    const quint32 BYTE_ORDER_MARK = 0x01020304;
+
+    // Each column has three sections, which each kind of column uses
+    // differently:
+    //   Text:    (empty), where each row's text starts, the text
+    //   Number:  the values, (empty), (empty)
+    //   Encoded: the codes, where each code's text starts, the text
+    // The starts have one more at the end for where the last text ends. After
+    // the columns comes a section for each sorted order, in the same slots as
+    // SortedOrderCache.
+    const int SECTIONS_PER_COLUMN = 3;
+    const int ORDER_COUNT = COLUMN_COUNT * 2;
+    const int ORDERS_SECTION = COLUMN_COUNT * SECTIONS_PER_COLUMN;
+    const int SECTION_COUNT = ORDERS_SECTION + ORDER_COUNT;
+
+    // Every section starts at a multiple of this, so its arrays can be used
+    // right where they are in the mapped file.
+    const int SECTION_ALIGNMENT = 8;
+
+    // The longest locale name a snapshot can hold, with room for a 0 after it.
+    const int LOCALE_NAME_SIZE = 32;
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 columnCount;
+        quint32 rowCount;
+        SnapshotSource source;
+        // The locale the text was sorted in, since the orders of the text and
+        // encoded columns are only right for that locale.
+        char locale[LOCALE_NAME_SIZE];
+        quint64 fileSize;
+        quint64 offsets[SECTION_COUNT];
+        quint64 sizes[SECTION_COUNT];
+    };
+
+    /*
+     * Hashes :param bytes: 8 at a time. Four words are mixed in at once, each
+     * into its own lane, so the multiplications don't have to wait for each
+     * other. It only has to notice a file that changed, not stand up to
+     * someone trying to fool it.
+     */
+    quint64 hashBytes(std::string_view bytes)
+    {
+        const quint64 MULTIPLIER = 0x9E3779B97F4A7C15ull;
+        quint64 lanes[4] = {bytes.size(), 1, 2, 3};
+        std::size_t i = 0;
+
+        for (; i + 32 <= bytes.size(); i += 32)
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                quint64 word;
+                std::memcpy(&word, bytes.data() + i + lane * 8, 8);
+                lanes[lane] = (lanes[lane] ^ word) * MULTIPLIER;
+                lanes[lane] ^= lanes[lane] >> 29;
+            }
+        }
+
+        quint64 hash = lanes[0];
+        for (int lane = 1; lane < 4; lane++)
+        {
+            hash = (hash ^ lanes[lane]) * MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        for (; i < bytes.size(); i += 8)
+        {
+            quint64 word = 0;
+            std::memcpy(&word, bytes.data() + i, std::min<std::size_t>(8, bytes.size() - i));
+            hash = (hash ^ word) * MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+
+    // The name of the locale text is sorted in right now, cut to fit in a
+    // SnapshotHeader.
+    QByteArray localeName()
+    {
+        return QLocale().name().toUtf8().left(LOCALE_NAME_SIZE - 1);
+    }
+
+    /*
+     * Gets the values in section :param index: of the mapped :param file:, as
+     * long as it is inside the file and holds exactly :param count: of them.
+     */
+    template <typename T>
+    const T* sectionValues(std::string_view file, const SnapshotHeader& header, int index, std::size_t count)
+    {
+        const quint64 offset = header.offsets[index];
+        const quint64 size = header.sizes[index];
+        if (size != count * sizeof(T) || offset % SECTION_ALIGNMENT != 0 || offset > file.size() || size > file.size() - offset)
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(file.data() + offset);
+    }
+
+    /*
+     * Gets the text of the column whose sections start at :param first:, and
+     * where each of its :param count: strings start in :param starts:. The
+     * starts have to go up from 0 and end inside the text.
+     */
+    const QChar* sectionText(std::string_view file, const SnapshotHeader& header, int first, std::size_t count, const quint32*& starts)
+    {
+        starts = sectionValues<quint32>(file, header, first + 1, count + 1);
+        if (!starts || starts[0] != 0)
+        {
+            return nullptr;
+        }
+        for (std::size_t i = 1; i <= count; i++)
+        {
+            if (starts[i] < starts[i - 1])
+            {
+                return nullptr;
+            }
+        }
+        return sectionValues<QChar>(file, header, first + 2, starts[count]);
+    }
+
+    // Keeps :param file: mapped until the program ends. The records read from
+    // it point at its text and the orders read from it are only copied once
+    // they are used, so it can't be closed while any of them could still be
+    // around. It is never deleted, so it can't be closed during exit either.
+    void keepMapped(csv::MappedFile&& file)
+    {
+        static QMutex lock;
+        static std::vector<csv::MappedFile>* files = new std::vector<csv::MappedFile>();
+
+        QMutexLocker locker(&lock);
+        files->push_back(std::move(file));
+    }
+}
+
+
+// Gets the size, modification time and hash of the csv file at :param csvPath:.
+bool readSnapshotSource(const QString& csvPath, SnapshotSource& out)
+{
+    const QFileInfo info(csvPath);
+    if (!info.isFile())
+    {
+        return false;
+    }
+
+    try
+    {
+        const csv::MappedFile file(csvPath.toStdString().c_str());
+        out.size = file.view().size();
+        out.hash = hashBytes(file.view());
+    }
+    catch (const csv::FileError&)
+    {
+        return false;
+    }
+    out.modified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+
+/*
+ * Gets where the snapshot of the csv file at :param csvPath: is kept, or an
+ * empty string if there is nowhere to keep it. Files with the same name in
+ * different folders each get their own.
+ */
+QString snapshotPath(const QString& csvPath)
+{
+    const QString folder = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (folder.isEmpty())
+    {
+        return QString();
+    }
+
+    const QFileInfo info(csvPath);
+    const QByteArray absolutePath = info.absoluteFilePath().toUtf8();
+    const quint64 pathHash = hashBytes(std::string_view(absolutePath.constData(), absolutePath.size()));
+    return QString("%1/%2-%3.snapshot").arg(folder, info.completeBaseName()).arg(pathHash, 16, 16, QChar('0'));
+}
+
+
+/*
+ * Reads the teams of the csv file at :param csvPath: from its snapshot into
+ * :param out:, and hands the sorted orders in it to :param orders: (if given).
+ * Returns false without changing either of them if there is no snapshot, the
+ * file has changed since it was made, or it can't be used for any other
+ * reason, in which case the csv file has to be read instead.
+ *
+ * The snapshot stays mapped for as long as the program runs, since the text of
+ * the records and the orders are used right where they are instead of being
+ * copied.
+ */
+bool readSnapshot(const QString& csvPath, QVector<TeamRecord>& out, SortedOrderCache* orders)
+{
+    const QString path = snapshotPath(csvPath);
+    SnapshotSource source;
+    if (path.isEmpty() || !QFileInfo::exists(path) || !readSnapshotSource(csvPath, source))
+    {
+        return false;
+    }
+
+    csv::MappedFile file;
+    try
+    {
+        file.open(path.toStdString().c_str());
+    }
+    catch (const csv::FileError&)
+    {
+        return false;
+    }
+    const std::string_view bytes = file.view();
+
+    SnapshotHeader header;
+    if (bytes.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+        || header.version != SNAPSHOT_VERSION
+        || header.byteOrder != BYTE_ORDER_MARK
+        || header.columnCount != static_cast<quint32>(COLUMN_COUNT)
+        || header.rowCount > static_cast<quint32>(std::numeric_limits<int>::max())
+        || header.fileSize != bytes.size()
+        || header.source.size != source.size
+        || header.source.modified != source.modified
+        || header.source.hash != source.hash
+        || QByteArray(header.locale, static_cast<int>(qstrnlen(header.locale, LOCALE_NAME_SIZE))) != localeName())
+    {
+        return false;
+    }
+
+    const int rowCount = static_cast<int>(header.rowCount);
+    QVector<TeamRecord> records(rowCount);
+    TeamRecord* record = records.data();
+    bool valid = true;
+
+    for (int column = 0; column < COLUMN_COUNT && valid; column++)
+    {
+        const int first = column * SECTIONS_PER_COLUMN;
+        valid = visitColumn(static_cast<Column>(column), [&](auto constant) -> bool
+        {
+            typedef ColumnTraits<decltype(constant)::value> Traits;
+
+            if constexpr (Traits::kind == ColumnKind::Text)
+            {
+                const quint32* starts;
+                const QChar* text = sectionText(bytes, header, first, rowCount, starts);
+                if (!text)
+                {
+                    return false;
+                }
+                for (int row = 0; row < rowCount; row++)
+                {
+                    record[row].*Traits::member = QString::fromRawData(text + starts[row], starts[row + 1] - starts[row]);
+                }
+            }
+            else if constexpr (Traits::encoded)
+            {
+                // The codes in the snapshot are turned into the codes this
+                // program's dictionary has for the same text.
+                const quint64 startsSize = header.sizes[first + 1];
+                if (startsSize < sizeof(quint32) || startsSize / sizeof(quint32) > static_cast<quint64>(Dictionary::MAX_SIZE) + 1)
+                {
+                    return false;
+                }
+                const std::size_t valueCount = startsSize / sizeof(quint32) - 1;
+
+                const quint32* codes = sectionValues<quint32>(bytes, header, first, rowCount);
+                const quint32* starts;
+                const QChar* text = sectionText(bytes, header, first, valueCount, starts);
+                if (!codes || !text)
+                {
+                    return false;
+                }
+
+                Dictionary& dictionary = columnDictionary(decltype(constant)::value);
+                std::vector<DictionaryCode> renumbered(valueCount);
+                for (std::size_t i = 0; i < valueCount; i++)
+                {
+                    if (!dictionary.encode(QString(text + starts[i], starts[i + 1] - starts[i]), renumbered[i]))
+                    {
+                        return false;
+                    }
+                }
+                for (int row = 0; row < rowCount; row++)
+                {
+                    if (codes[row] >= valueCount)
+                    {
+                        return false;
+                    }
+                    record[row].*Traits::member = renumbered[codes[row]];
+                }
+            }
+            else
+            {
+                const quint32* values = sectionValues<quint32>(bytes, header, first, rowCount);
+                if (!values)
+                {
+                    return false;
+                }
+                for (int row = 0; row < rowCount; row++)
+                {
+                    if (values[row] > std::numeric_limits<typename Traits::Type>::max())
+                    {
+                        return false;
+                    }
+                    record[row].*Traits::member = static_cast<typename Traits::Type>(values[row]);
+                }
+            }
+            return true;
+        });
+    }
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    // SortedOrderCache checks each order again when it is first used, since
+    // going through all of them now would touch every page of them.
+    if (orders)
+    {
+        orders->clear();
+        for (int slot = 0; slot < ORDER_COUNT; slot++)
+        {
+            const quint32* order = sectionValues<quint32>(bytes, header, ORDERS_SECTION + slot, rowCount);
+            if (order)
+            {
+                orders->preset(static_cast<Column>(slot / 2), slot % 2 == 1, order, rowCount);
+            }
+        }
+    }
+
+    keepMapped(std::move(file));
+    out.append(records);
+
+    return true;
+}
+
+
+/*
+ * Makes a snapshot of :param records:, which were read from the csv file at
+ * :param csvPath: when it looked like :param source:. Every sorted order is
+ * worked out for it, so this can take a while for a big file and is best done
+ * on another thread. The old snapshot is only replaced once the new one has
+ * been written completely.
+ */
+bool writeSnapshot(const QString& csvPath, const SnapshotSource& source, const QVector<TeamRecord>& records)
+{
+    const QString path = snapshotPath(csvPath);
+    if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath()))
+    {
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.columnCount = COLUMN_COUNT;
+    header.rowCount = records.size();
+    header.source = source;
+    const QByteArray locale = localeName();
+    std::memcpy(header.locale, locale.constData(), locale.size());
+
+    // The header is written last, once it knows where every section is.
+    quint64 position = sizeof(header);
+    bool written = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+    auto addSection = [&file, &header, &position, &written](int index, const void* data, std::size_t size)
+    {
+        static const char padding[SECTION_ALIGNMENT] = {};
+        const qint64 paddingSize = (SECTION_ALIGNMENT - position % SECTION_ALIGNMENT) % SECTION_ALIGNMENT;
+
+        written = written && file.write(padding, paddingSize) == paddingSize && file.write(static_cast<const char*>(data), size) == static_cast<qint64>(size);
+        header.offsets[index] = position + paddingSize;
+        header.sizes[index] = size;
+        position += paddingSize + size;
+    };
+
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        const int first = column * SECTIONS_PER_COLUMN;
+        visitColumn(static_cast<Column>(column), [&](auto constant)
+        {
+            typedef ColumnTraits<decltype(constant)::value> Traits;
+
+            if constexpr (Traits::kind == ColumnKind::Text)
+            {
+                std::vector<quint32> starts(1, 0);
+                QString text;
+                starts.reserve(records.size() + 1);
+                for (auto it = records.cbegin(); it != records.cend(); it++)
+                {
+                    text += (*it).*Traits::member;
+                    starts.push_back(text.size());
+                }
+                addSection(first + 1, starts.data(), starts.size() * sizeof(quint32));
+                addSection(first + 2, text.constData(), text.size() * sizeof(QChar));
+            }
+            else if constexpr (Traits::encoded)
+            {
+                // Only the codes that are used are written, numbered again in
+                // the order they are first used, since the dictionary also has
+                // the values of every other file that has been read.
+                const Dictionary& dictionary = columnDictionary(decltype(constant)::value);
+                std::vector<qint32> renumbered(dictionary.size(), -1);
+                std::vector<quint32> codes;
+                std::vector<quint32> starts(1, 0);
+                QString text;
+                codes.reserve(records.size());
+                for (auto it = records.cbegin(); it != records.cend(); it++)
+                {
+                    const DictionaryCode code = (*it).*Traits::member;
+                    if (renumbered[code] < 0)
+                    {
+                        renumbered[code] = static_cast<qint32>(starts.size() - 1);
+                        text += dictionary.text(code);
+                        starts.push_back(text.size());
+                    }
+                    codes.push_back(renumbered[code]);
+                }
+                addSection(first, codes.data(), codes.size() * sizeof(quint32));
+                addSection(first + 1, starts.data(), starts.size() * sizeof(quint32));
+                addSection(first + 2, text.constData(), text.size() * sizeof(QChar));
+            }
+            else
+            {
+                std::vector<quint32> values;
+                values.reserve(records.size());
+                for (auto it = records.cbegin(); it != records.cend(); it++)
+                {
+                    values.push_back((*it).*Traits::member);
+                }
+                addSection(first, values.data(), values.size() * sizeof(quint32));
+            }
+        });
+    }
+
+    // The orders are the same ones the table would work out, so they can be
+    // used in its place.
+    static_assert(sizeof(int) == sizeof(quint32), "Orders are written as they are stored");
+    QVector<const TeamRecord*> rows;
+    rows.reserve(records.size());
+    for (auto it = records.cbegin(); it != records.cend(); it++)
+    {
+        rows.push_back(&*it);
+    }
+    SortKeyCache keys;
+    std::vector<int> order;
+    for (int slot = 0; slot < ORDER_COUNT && written; slot++)
+    {
+        sortOrder(rows, sortKeysFor(static_cast<Column>(slot / 2), slot % 2 == 1), order, &keys);
+        addSection(ORDERS_SECTION + slot, order.data(), order.size() * sizeof(int));
+    }
+
+    header.fileSize = position;
+    if (!written || !file.seek(0) || file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header))
+    {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
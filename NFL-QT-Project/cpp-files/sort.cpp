@@ -1,52 +1,725 @@
+#include "parallel.h"
 #include "sort.h"
+#include <QCollator>
+#include <QHash>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <numeric>
+#include <vector>
 
-inline bool compareQTableWidgetItems(QTableWidgetItem* first, QTableWidgetItem* second, bool ascending)
+
+namespace
 {
-    // QT will not properly sort numbers if they have commas in them (i.e. "6,700" and "100"
-    // will not sort correctly) so to handle this we will do the checking for those types
-    // ourself. If both are numbers, then we convert to actual values and then do the
-    // comparison.
-    //
-    // Unfortunately it does look a bit messy because we shortcut some things.
-    QVariant firstVar, secondVar;
+    // Adding this many rows or fewer to a sorted order (or one for every
+    // SMALL_APPEND_FRACTION rows already in it, if that is more) is done by
+    // finding where each one goes instead of going through every row.
+    const int SMALL_APPEND_ROWS = 16;
+    const int SMALL_APPEND_FRACTION = 256;
+
+
+    // Splits [0, :param size:) into :param parts: ranges that are as even as
+    // possible and gets the one at :param part:.
+    inline void partRange(std::size_t size, std::size_t parts, std::size_t part, std::size_t& from, std::size_t& to)
+    {
+        from = size * part / parts;
+        to = size * (part + 1) / parts;
+    }
+
+
+    /*
+     * Stable LSD radix sort of :param order: (indexes into :param keys:) by
+     * their keys, one byte at a time starting with the lowest. Bytes that are
+     * the same for every row are skipped, so a column with fewer than 256
+     * different values only takes one pass.
+     *
+     * With more than one thread, :param order: is split into one part per
+     * thread. Every part counts its own bytes, and the parts are given their
+     * places for each byte value in order, so the result is still stable.
+     */
+    void radixSort(std::vector<int>& order, const std::vector<quint32>& keys, std::vector<int>& scratch, std::size_t threads)
+    {
+        const std::size_t size = order.size();
+        if (size == 0)
+        {
+            return;
+        }
+
+        const std::size_t parts = std::min(threads, size);
+        std::vector<std::array<std::size_t, 256>> counts(parts);
+        scratch.resize(size);
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            runTasks(parts, threads, [&](std::size_t part)
+            {
+                std::size_t from, to;
+                partRange(size, parts, part, from, to);
+
+                counts[part].fill(0);
+                for (std::size_t i = from; i < to; i++)
+                {
+                    counts[part][(keys[order[i]] >> shift) & 0xFF]++;
+                }
+            });
+
+            // If every row has the same byte here then there is nothing to do.
+            const quint32 firstByte = (keys[order[0]] >> shift) & 0xFF;
+            std::size_t sameAsFirst = 0;
+            for (std::size_t part = 0; part < parts; part++)
+            {
+                sameAsFirst += counts[part][firstByte];
+            }
+            if (sameAsFirst == size)
+            {
+                continue;
+            }
+
+            // Turn the counts into where each part's rows with each byte value
+            // start.
+            std::size_t offset = 0;
+            for (int byte = 0; byte < 256; byte++)
+            {
+                for (std::size_t part = 0; part < parts; part++)
+                {
+                    std::size_t count = counts[part][byte];
+                    counts[part][byte] = offset;
+                    offset += count;
+                }
+            }
+
+            runTasks(parts, threads, [&](std::size_t part)
+            {
+                std::size_t from, to;
+                partRange(size, parts, part, from, to);
+
+                std::array<std::size_t, 256>& starts = counts[part];
+                for (std::size_t i = from; i < to; i++)
+                {
+                    scratch[starts[(keys[order[i]] >> shift) & 0xFF]++] = order[i];
+                }
+            });
+            order.swap(scratch);
+        }
+    }
+
+
+    /*
+     * Gives each of :param values: its rank in :param out: when they are put in
+     * the order QString::localeAwareCompare puts them in. Values that compare
+     * equal share a rank.
+     *
+     * Comparing with the locale is slow, so the values are first sorted by
+     * their QCollator sort keys, which are only made once per value and are
+     * compared as plain bytes. That should already be the locale's order,
+     * which is then checked with one localeAwareCompare per neighbouring pair.
+     * If the collator disagrees anywhere, the values are sorted again with
+     * localeAwareCompare itself.
+     */
+    void rankByLocale(const QVector<QString>& values, std::vector<quint32>& out)
+    {
+        std::vector<int> order(values.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        QCollator collator;
+        std::vector<QCollatorSortKey> keys;
+        keys.reserve(values.size());
+        for (int i = 0; i < values.size(); i++)
+        {
+            keys.push_back(collator.sortKey(values[i]));
+        }
+        std::sort(order.begin(), order.end(), [&keys](int first, int second)
+        {
+            return keys[first].compare(keys[second]) < 0;
+        });
+
+        // Whether each value in order is equal to the one before it.
+        std::vector<bool> tied(order.size(), false);
+        for (std::size_t i = 1; i < order.size(); i++)
+        {
+            const int result = QString::localeAwareCompare(values[order[i - 1]], values[order[i]]);
+            if (result > 0)
+            {
+                std::sort(order.begin(), order.end(), [&values](int first, int second)
+                {
+                    return QString::localeAwareCompare(values[first], values[second]) < 0;
+                });
+                for (std::size_t j = 1; j < order.size(); j++)
+                {
+                    tied[j] = QString::localeAwareCompare(values[order[j - 1]], values[order[j]]) == 0;
+                }
+                break;
+            }
+            tied[i] = result == 0;
+        }
+
+        out.resize(values.size());
+        quint32 rank = 0;
+        for (std::size_t i = 0; i < order.size(); i++)
+        {
+            if (i > 0 && !tied[i])
+            {
+                rank++;
+            }
+            out[order[i]] = rank;
+        }
+    }
+
+
+    /*
+     * The ascending key (see SortKeyCache::columnKeys) of the rows in each
+     * column, after the rows from :param firstNew: on were added. When lots
+     * were added, every row is going to be compared, so each column's keys are
+     * worked out for all of them at once. When only a few were added, only the
+     * rows a binary search lands on are, so each of those is looked up on its
+     * own instead. Either way a column is only set up the first time it is used.
+     */
+    class RowKeys
+    {
+    public:
+        RowKeys(const QVector<const TeamRecord*>& rows, int firstNew, SortKeyCache* cache) : rows(rows), firstNew(firstNew), cache(cache), full(rows.size() - firstNew > std::max(SMALL_APPEND_ROWS, firstNew / SMALL_APPEND_FRACTION)), rankedAgain(false)
+        {
+            std::fill(std::begin(this->ready), std::end(this->ready), false);
+        }
+
+        // Gets the keys of every row in :param column:, or nullptr if only a
+        // few rows were added and each one has to be looked up with key.
+        const quint32* allKeys(Column column)
+        {
+            const int index = static_cast<int>(column);
+            if (!this->ready[index])
+            {
+                this->prepare(column);
+            }
+            return this->full ? this->keys[index].data() : nullptr;
+        }
+
+        quint32 key(Column column, int row)
+        {
+            quint32 key;
+            if (!this->cache->rowKey(*this->rows[row], column, key))
+            {
+                // The old rows' text was never ranked (like when their order
+                // came from a snapshot), so rank all of it once. That changes
+                // the ranks of the rows compared so far.
+                this->cache->columnKeys(this->rows, SortKey{column, true}, this->keys[static_cast<int>(column)]);
+                this->cache->rowKey(*this->rows[row], column, key);
+                this->rankedAgain = true;
+            }
+            return key;
+        }
+
+        // Whether key had to rank the text again since the last time this was
+        // called, in which case anything worked out with the old ranks is wrong.
+        bool wasRankedAgain()
+        {
+            const bool ranked = this->rankedAgain;
+            this->rankedAgain = false;
+            return ranked;
+        }
+    private:
+        void prepare(Column column)
+        {
+            const int index = static_cast<int>(column);
+            if (this->full)
+            {
+                const std::size_t threads = this->rows.size() >= PARALLEL_MIN_ROWS ? defaultThreadCount() : 1;
+                this->cache->columnKeys(this->rows, SortKey{column, true}, this->keys[index], threads);
+            }
+            else
+            {
+                // Working out the keys of the new rows ranks any text in them
+                // that hasn't been ranked yet.
+                this->cache->columnKeys(this->rows.mid(this->firstNew), SortKey{column, true}, this->keys[index]);
+            }
+            this->ready[index] = true;
+        }
+
+        const QVector<const TeamRecord*>& rows;
+        int firstNew;
+        SortKeyCache* cache;
+        bool full;
+        bool rankedAgain;
+        std::vector<quint32> keys[COLUMN_COUNT];
+        bool ready[COLUMN_COUNT];
+    };
+
+
+    /*
+     * Adds the rows from :param firstNew: to the end of the rows to
+     * :param order:, which has every row before them sorted by
+     * :param sortKeys:. The new rows are sorted on their own and then merged
+     * in, the old rows coming first when they tie with a new one, the same as
+     * if everything was sorted again. When only a few were added, each one's
+     * place is found with a binary search instead of going through every row.
+     */
+    void addToOrder(std::vector<int>& order, int firstNew, int rowCount, const QVector<SortKey>& sortKeys, RowKeys& keys)
+    {
+        const int keyCount = sortKeys.size();
+        Column columns[COLUMN_COUNT];
+        const quint32* columnKeys[COLUMN_COUNT];
+        quint32 flips[COLUMN_COUNT];
+        for (int i = 0; i < keyCount; i++)
+        {
+            columns[i] = sortKeys[i].column;
+            columnKeys[i] = keys.allKeys(columns[i]);
+            flips[i] = sortKeys[i].ascending ? 0 : ~static_cast<quint32>(0);
+        }
+
+        auto comesBefore = [&](int first, int second)
+        {
+            for (int i = 0; i < keyCount; i++)
+            {
+                const quint32 firstKey = (columnKeys[i] ? columnKeys[i][first] : keys.key(columns[i], first)) ^ flips[i];
+                const quint32 secondKey = (columnKeys[i] ? columnKeys[i][second] : keys.key(columns[i], second)) ^ flips[i];
+                if (firstKey != secondKey)
+                {
+                    return firstKey < secondKey;
+                }
+            }
+            return false;
+        };
+
+        std::vector<int> added(rowCount - firstNew);
+        std::vector<int> merged;
+        do
+        {
+            std::iota(added.begin(), added.end(), firstNew);
+            std::stable_sort(added.begin(), added.end(), comesBefore);
+
+            merged.clear();
+            merged.reserve(order.size() + added.size());
+            if (columnKeys[0])
+            {
+                std::merge(order.begin(), order.end(), added.begin(), added.end(), std::back_inserter(merged), comesBefore);
+            }
+            else
+            {
+                // Going after every row it ties with keeps the new rows in the
+                // order they were added.
+                auto from = order.begin();
+                for (auto row = added.cbegin(); row != added.cend(); row++)
+                {
+                    const auto to = std::upper_bound(from, order.end(), *row, comesBefore);
+                    merged.insert(merged.end(), from, to);
+                    merged.push_back(*row);
+                    from = to;
+                }
+                merged.insert(merged.end(), from, order.end());
+            }
+        }
+        while (keys.wasRankedAgain());
+        order.swap(merged);
+    }
+}
 
-    if (!isCommaNumber((firstVar = first->data(0)).toString()) ||
-        !isCommaNumber((secondVar = second->data(0)).toString()))
+
+/*
+ * Compares two records by each of the keys in turn, only moving on to the next
+ * key when the records are equal in the one before it. Returns true if
+ * :param first: belongs before :param second:.
+ */
+bool compareRecords(const TeamRecord* first, const TeamRecord* second, const QVector<SortKey>& keys)
+{
+    for (auto key = keys.cbegin(); key != keys.cend(); key++)
     {
-        return ascending ? *first < *second: *second < *first;
+        int result = compareColumn(*first, *second, key->column);
+
+        if (result != 0)
+        {
+            return key->ascending ? result < 0 : result > 0;
+        }
     }
+    return false;
+}
+
+
+/*
+ * Works out a number for every row that puts the rows in the same order as
+ * compareColumn would, so sorting never has to look at the column again.
+ * Numbers are used as they are, and text gets its rank between all of the
+ * different values that have been seen in the column. For descending keys
+ * every bit is flipped so that the biggest values come first. The rows are
+ * split up between :param threads: threads.
+ */
+void SortKeyCache::columnKeys(const QVector<const TeamRecord*>& rows, const SortKey& key, std::vector<quint32>& out, std::size_t threads)
+{
+    const quint32 flip = key.ascending ? 0 : ~static_cast<quint32>(0);
+    const std::size_t size = rows.size();
+    const std::size_t parts = std::max<std::size_t>(1, std::min(threads, size));
+
+    out.resize(size);
+
+    visitColumn(key.column, [this, &rows, &out, flip, size, parts, threads](auto constant)
+    {
+        constexpr Column current = decltype(constant)::value;
+        typedef ColumnTraits<current> Traits;
 
-    double result1 = qvarToULongLong(firstVar);
-    double result2 = qvarToULongLong(secondVar);
+        if constexpr (Traits::numeric)
+        {
+            runTasks(parts, threads, [&](std::size_t part)
+            {
+                std::size_t from, to;
+                partRange(size, parts, part, from, to);
+                for (std::size_t i = from; i < to; i++)
+                {
+                    out[i] = static_cast<quint32>(get<current>(*rows[i])) ^ flip;
+                }
+            });
+        }
+        else if constexpr (Traits::encoded)
+        {
+            const std::vector<quint32>& ranks = this->codeRanks(current);
+            runTasks(parts, threads, [&](std::size_t part)
+            {
+                std::size_t from, to;
+                partRange(size, parts, part, from, to);
+                for (std::size_t i = from; i < to; i++)
+                {
+                    out[i] = ranks[get<current>(*rows[i])] ^ flip;
+                }
+            });
+        }
+        else
+        {
+            const QHash<QString, quint32>& ranks = this->textRanks[static_cast<int>(current)];
+            std::atomic<bool> missing(false);
 
-    return ascending ? result1 < result2 : result2 < result1;
+            // Every thread only reads the ranks, so they can share them.
+            auto lookUp = [&](std::size_t part)
+            {
+                std::size_t from, to;
+                partRange(size, parts, part, from, to);
+                for (std::size_t i = from; i < to && !missing; i++)
+                {
+                    auto found = ranks.constFind(get<current>(*rows[i]));
+                    if (found == ranks.constEnd())
+                    {
+                        missing = true;
+                        break;
+                    }
+                    out[i] = found.value() ^ flip;
+                }
+            };
+
+            runTasks(parts, threads, lookUp);
+            if (missing)
+            {
+                // There is a value we haven't ranked yet, so rank them all
+                // again and start over.
+                this->rankText(rows, current);
+                missing = false;
+                runTasks(parts, threads, lookUp);
+            }
+        }
+    });
 }
 
 
 /*
- * Sorts the items in the vector, from [start, end), using the specified column.
- * Sorts in ascending order if ascending is true, otherwise descending.
+ * Gets the key of :param record: in :param column: into :param out: when
+ * sorting it in ascending order, the same as columnKeys would. Returns false
+ * if its text hasn't been ranked yet, which giving columnKeys rows that
+ * include it does.
  */
-void sortColumn(QVector<std::array<QTableWidgetItem*, 10>>& rows, int start, int end, int column, bool ascending)
+bool SortKeyCache::rowKey(const TeamRecord& record, Column column, quint32& out)
 {
-    for (int i = start; i < end; i++)
+    return visitColumn(column, [this, &record, &out](auto constant) -> bool
     {
-        for (int j = i + 1; j < end; j++)
+        constexpr Column current = decltype(constant)::value;
+        typedef ColumnTraits<current> Traits;
+
+        if constexpr (Traits::numeric)
+        {
+            out = static_cast<quint32>(get<current>(record));
+        }
+        else if constexpr (Traits::encoded)
+        {
+            out = this->codeRanks(current)[get<current>(record)];
+        }
+        else
         {
-            if (compareQTableWidgetItems(rows[i][column], rows[j][column], ascending))
+            const QHash<QString, quint32>& ranks = this->textRanks[static_cast<int>(current)];
+            auto found = ranks.constFind(get<current>(record));
+            if (found == ranks.constEnd())
             {
-                std::swap(rows[i], rows[j]);
+                return false;
             }
+            out = found.value();
+        }
+        return true;
+    });
+}
+
+
+/*
+ * Ranks every value of the text column :param column: from the rows along with
+ * every value that was already ranked, in the order compareColumn puts them.
+ */
+void SortKeyCache::rankText(const QVector<const TeamRecord*>& rows, Column column)
+{
+    QHash<QString, quint32>& ranks = this->textRanks[static_cast<int>(column)];
+
+    ranks.reserve(ranks.size() + rows.size());
+    for (int i = 0; i < rows.size(); i++)
+    {
+        ranks.insert(rows[i]->text(column), 0);
+    }
+
+    const QVector<QString> values = ranks.keys().toVector();
+    std::vector<quint32> valueRanks;
+    rankByLocale(values, valueRanks);
+    for (int i = 0; i < values.size(); i++)
+    {
+        ranks[values[i]] = valueRanks[i];
+    }
+}
+
+
+/*
+ * Gets the rank of each code of an encoded column by its text. There are only
+ * a few codes, so they are all ranked again whenever the dictionary grows.
+ */
+const std::vector<quint32>& SortKeyCache::codeRanks(Column column)
+{
+    const Dictionary& dictionary = columnDictionary(column);
+    std::vector<quint32>& ranks = this->encodedRanks[static_cast<int>(column)];
+
+    const int size = dictionary.size();
+    if (static_cast<int>(ranks.size()) != size)
+    {
+        QVector<QString> values;
+        values.reserve(size);
+        for (int code = 0; code < size; code++)
+        {
+            values.push_back(dictionary.text(static_cast<DictionaryCode>(code)));
+        }
+        rankByLocale(values, ranks);
+    }
+    return ranks;
+}
+
+
+// Forgets every rank, for when the values that were ranked are gone.
+void SortKeyCache::clear()
+{
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        this->textRanks[column].clear();
+        this->encodedRanks[column].clear();
+    }
+}
+
+
+/*
+ * Works out the order the rows go in when they are sorted by the keys, the
+ * first key being the most important. :param order: is filled with indexes
+ * into :param rows:. The sort is stable, so rows that are equal in every key
+ * stay in the order they were in.
+ *
+ * Each key is turned into one number per row up front, then the rows are
+ * radix sorted by the keys from the least important to the most important.
+ * Since every pass is stable, rows only end up apart in an earlier key's
+ * order if a later key puts them apart. Giving a :param cache: that lives
+ * between sorts saves ranking the text columns every time.
+ *
+ * If :param threads: is 0 then big sets of rows are split up between one
+ * thread per core and small ones are sorted on this thread.
+ */
+void sortOrder(const QVector<const TeamRecord*>& rows, const QVector<SortKey>& keys, std::vector<int>& order, SortKeyCache* cache, std::size_t threads)
+{
+    SortKeyCache localCache;
+    if (!cache)
+    {
+        cache = &localCache;
+    }
+
+    if (threads == 0)
+    {
+        threads = (rows.size() >= PARALLEL_MIN_ROWS) ? defaultThreadCount() : 1;
+    }
+
+    std::vector<int> scratch;
+    std::vector<quint32> columnKey;
+
+    order.resize(rows.size());
+    for (int i = 0; i < rows.size(); i++)
+    {
+        order[i] = i;
+    }
+
+    for (int key = keys.size() - 1; key >= 0; key--)
+    {
+        cache->columnKeys(rows, keys[key], columnKey, threads);
+        radixSort(order, columnKey, scratch, threads);
+    }
+}
+
+
+// Sorts the rows themselves, see sortOrder.
+void sortRecords(QVector<const TeamRecord*>& rows, const QVector<SortKey>& keys, SortKeyCache* cache)
+{
+    std::vector<int> order;
+    sortOrder(rows, keys, order, cache);
+
+    QVector<const TeamRecord*> sorted;
+    sorted.reserve(rows.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+    {
+        sorted.push_back(rows[order[i]]);
+    }
+    rows.swap(sorted);
+}
+
+
+SortedOrderCache::SortedOrderCache()
+{
+    this->clear();
+}
+
+
+/*
+ * Gets the order of :param rows: when sorted by the user clicking on
+ * :param column:, sorting them only if it isn't cached already. A preset order
+ * is used once it is asked for, with any rows added since it was made merged
+ * into it then.
+ */
+const std::vector<int>& SortedOrderCache::order(const QVector<const TeamRecord*>& rows, Column column, bool ascending, SortKeyCache* keys)
+{
+    const int slot = static_cast<int>(column) * 2 + (ascending ? 1 : 0);
+    if (this->valid[slot])
+    {
+        return this->orders[slot];
+    }
+
+    const int presetSize = this->presetSizes[slot];
+    if (this->usePreset(slot, rows.size()))
+    {
+        if (presetSize < rows.size())
+        {
+            SortKeyCache localCache;
+            RowKeys rowKeys(rows, presetSize, keys ? keys : &localCache);
+            addToOrder(this->orders[slot], presetSize, rows.size(), sortKeysFor(column, ascending), rowKeys);
+        }
+    }
+    else
+    {
+        sortOrder(rows, sortKeysFor(column, ascending), this->orders[slot], keys);
+        this->valid[slot] = true;
+    }
+    return this->orders[slot];
+}
+
+
+/*
+ * Patches every cached order after rows were added to the end of
+ * :param rows:, starting at :param firstNew:. The rows are compared by their
+ * keys, which are shared between the slots, so comparing them never has to
+ * compare any text. Presets that haven't been used yet are left alone, since
+ * the new rows are merged into them when they are first asked for.
+ */
+void SortedOrderCache::rowsAppended(const QVector<const TeamRecord*>& rows, int firstNew, SortKeyCache* keys)
+{
+    if (firstNew >= rows.size())
+    {
+        return;
+    }
+
+    SortKeyCache localCache;
+    RowKeys rowKeys(rows, firstNew, keys ? keys : &localCache);
+    for (int slot = 0; slot < COLUMN_COUNT * 2; slot++)
+    {
+        if (!this->valid[slot])
+        {
+            continue;
+        }
+        addToOrder(this->orders[slot], firstNew, rows.size(), sortKeysFor(static_cast<Column>(slot / 2), slot % 2 == 1), rowKeys);
+    }
+}
+
+
+/*
+ * Hands over the order of the first :param size: rows when sorted by
+ * :param column:, so it doesn't have to be sorted when it is first asked for.
+ * :param order: isn't copied until then.
+ */
+void SortedOrderCache::preset(Column column, bool ascending, const quint32* order, int size)
+{
+    const int slot = static_cast<int>(column) * 2 + (ascending ? 1 : 0);
+
+    this->orders[slot].clear();
+    this->valid[slot] = false;
+    this->presets[slot] = order;
+    this->presetSizes[slot] = size;
+}
+
+
+// Forgets every order, for when rows were changed or taken away.
+void SortedOrderCache::clear()
+{
+    for (int slot = 0; slot < COLUMN_COUNT * 2; slot++)
+    {
+        this->orders[slot].clear();
+        this->valid[slot] = false;
+        this->presets[slot] = nullptr;
+        this->presetSizes[slot] = 0;
+    }
+}
+
+
+/*
+ * Copies the preset order of :param slot: into orders if there is one and it
+ * is for :param rowCount: rows or fewer (the first rows, before any were added
+ * to the end). A preset that isn't an order of each of its rows once (from a
+ * damaged file) is thrown away so the rows get sorted instead.
+ */
+bool SortedOrderCache::usePreset(int slot, int rowCount)
+{
+    const quint32* preset = this->presets[slot];
+    const int size = this->presetSizes[slot];
+    this->presets[slot] = nullptr;
+    if (!preset || size > rowCount)
+    {
+        return false;
+    }
+
+    std::vector<int>& order = this->orders[slot];
+    std::vector<bool> seen(size, false);
+    order.resize(size);
+    for (int i = 0; i < size; i++)
+    {
+        if (preset[i] >= static_cast<quint32>(size) || seen[preset[i]])
+        {
+            order.clear();
+            return false;
         }
+        seen[preset[i]] = true;
+        order[i] = static_cast<int>(preset[i]);
     }
+
+    this->valid[slot] = true;
+    return true;
 }
 
 
 /*
- * Checks if two QTableWidgetItems are equal (because it does not give us the
- * ability to do so natively).
+ * Gets the keys used when the user sorts by :param column:. Teams that tie
+ * are put in order by their team name, except for teams in the same state
+ * which go by their city first.
  */
-bool operator==(const QTableWidgetItem& first, const QTableWidgetItem& second)
+QVector<SortKey> sortKeysFor(Column column, bool ascending)
 {
-    return !(first < second) && !(second < first);
+    QVector<SortKey> keys;
+    keys.push_back(SortKey{column, ascending});
+
+    if (column == Column::State)
+    {
+        keys.push_back(SortKey{Column::City, ascending});
+    }
+    if (column != Column::TeamName)
+    {
+        keys.push_back(SortKey{Column::TeamName, ascending});
+    }
+    return keys;
 }
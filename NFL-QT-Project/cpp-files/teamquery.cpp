@@ -0,0 +1,381 @@
+#include "teamquery.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <vector>
+
+
+namespace
+{
+    void setError(QString* error, const QString& message)
+    {
+        if (error)
+        {
+            *error = message;
+        }
+    }
+
+    // Gets the value of :param column: to write out. Numbers are written
+    // without thousands separators, so other programs can read them.
+    QString fieldValue(const TeamRecord& record, Column column)
+    {
+        return visitColumn(column, [&record](auto constant) -> QString
+        {
+            if constexpr (ColumnTraits<decltype(constant)::value>::numeric)
+            {
+                return QString::number(get<decltype(constant)::value>(record));
+            }
+            return record.text(decltype(constant)::value);
+        });
+    }
+
+    // If :param keys: are the ones clicking on a column of the table sorts by,
+    // which are the ones a SortedOrderCache keeps the order of.
+    bool isColumnSort(const QVector<SortKey>& keys)
+    {
+        const QVector<SortKey> columnKeys = sortKeysFor(keys[0].column, keys[0].ascending);
+        if (keys.size() != columnKeys.size())
+        {
+            return false;
+        }
+        for (int i = 0; i < keys.size(); i++)
+        {
+            if (keys[i].column != columnKeys[i].column || keys[i].ascending != columnKeys[i].ascending)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+void QueryRow::add(const QString& value, bool number)
+{
+    this->values.append(value);
+    this->numbers.append(number);
+}
+
+
+/*
+ * Reads a list of columns to sort by, like "state,capacity:desc", from
+ * :param text: into :param out:. A single column is sorted the same way
+ * clicking on it in the table sorts it, and the team names break any ties
+ * left after that.
+ */
+bool parseSortKeys(const QString& text, QVector<SortKey>& out, QString* error)
+{
+    out.clear();
+    const QStringList parts = text.split(',');
+    for (auto it = parts.cbegin(); it != parts.cend(); it++)
+    {
+        const QStringList nameAndDirection = it->split(':');
+        SortKey key;
+        key.ascending = true;
+
+        if (!findColumn(nameAndDirection[0], key.column))
+        {
+            setError(error, QString("Unknown column to sort by: %1").arg(nameAndDirection[0]));
+            return false;
+        }
+        if (nameAndDirection.size() > 2 || (nameAndDirection.size() == 2 && nameAndDirection[1] != "asc" && nameAndDirection[1] != "desc"))
+        {
+            setError(error, QString("Expected a column and then :asc or :desc to sort by, not %1").arg(*it));
+            return false;
+        }
+        if (nameAndDirection.size() == 2)
+        {
+            key.ascending = nameAndDirection[1] == "asc";
+        }
+        out.push_back(key);
+    }
+
+    if (out.size() == 1)
+    {
+        out = sortKeysFor(out[0].column, out[0].ascending);
+        return true;
+    }
+
+    for (auto it = out.cbegin(); it != out.cend(); it++)
+    {
+        if (it->column == Column::TeamName)
+        {
+            return true;
+        }
+    }
+    out.push_back(SortKey{Column::TeamName, true});
+    return true;
+}
+
+
+/*
+ * Reads one or two columns to group by, like "conference,roof", from
+ * :param text:. :param second: is set to -1 if there is only one.
+ */
+bool parseGroupBy(const QString& text, Column& first, int& second, QString* error)
+{
+    const QStringList names = text.split(',');
+    if (names.size() > 2)
+    {
+        setError(error, "Teams can only be grouped by one or two columns.");
+        return false;
+    }
+
+    Column column = Column::TeamName;
+    for (int i = 0; i < names.size(); i++)
+    {
+        if (!findColumn(names[i], column))
+        {
+            setError(error, QString("Unknown column to group by: %1").arg(names[i]));
+            return false;
+        }
+        if (i == 0)
+        {
+            first = column;
+        }
+    }
+    second = names.size() == 2 ? static_cast<int>(column) : -1;
+    return true;
+}
+
+
+/*
+ * Puts the rows of :param rows: that pass :param expression: and match
+ * :param search: in :param out:, sorted by :param sortKeys:. Only the first
+ * :param onlyFirst: rows (the original list) can be picked. Without a sort,
+ * the matches of a search come best first and the other rows come in the
+ * order they were loaded. With a :param cache:, the search index and sorted
+ * orders are kept in it for the next query of the same rows, and a sort by a
+ * single column picks the rows out of its cached order instead of sorting
+ * them again.
+ */
+void selectRows(const QVector<const TeamRecord*>& rows, FilterExpression& expression, const QString& search,
+                const QVector<SortKey>& sortKeys, int onlyFirst, QVector<const TeamRecord*>& out, SelectionCache* cache)
+{
+    const int count = std::min(onlyFirst, rows.size());
+
+    std::vector<quint64> passed;
+    expression.evaluate(rows, 0, passed);
+    auto passes = [&expression, &passed, count](int row)
+    {
+        return row < count && (expression.isEmpty() || ((passed[row / 64] >> (row % 64)) & 1) != 0);
+    };
+
+    std::vector<int> picked;
+    if (search.size() >= SearchIndex::MIN_LENGTH)
+    {
+        auto pickMatches = [&picked, &passes](SearchIndex& index, const QString& text)
+        {
+            const QVector<SearchMatch>& matches = index.search(text);
+            for (auto it = matches.cbegin(); it != matches.cend(); it++)
+            {
+                if (passes(it->row))
+                {
+                    picked.push_back(it->row);
+                }
+            }
+        };
+
+        if (cache)
+        {
+            QMutexLocker locker(&cache->searchLock);
+            if (cache->search.size() < rows.size())
+            {
+                cache->search.add(rows, cache->search.size());
+            }
+            pickMatches(cache->search, search);
+        }
+        else
+        {
+            SearchIndex index;
+            index.add(count < rows.size() ? rows.mid(0, count) : rows);
+            pickMatches(index, search);
+        }
+    }
+    else
+    {
+        for (int row = 0; row < count; row++)
+        {
+            if (passes(row))
+            {
+                picked.push_back(row);
+            }
+        }
+    }
+
+    out.clear();
+    out.reserve(static_cast<int>(picked.size()));
+    if (cache && !sortKeys.isEmpty() && isColumnSort(sortKeys))
+    {
+        // Pick the rows out of the cached order of every row. The order never
+        // changes once it has been worked out, so it can be read without the
+        // lock.
+        const std::vector<int>* order;
+        {
+            QMutexLocker locker(&cache->sortLock);
+            order = &cache->sortedOrders.order(rows, sortKeys[0].column, sortKeys[0].ascending, &cache->sortKeys);
+        }
+
+        std::vector<quint64> pickedBits((rows.size() + 63) / 64, 0);
+        for (auto it = picked.cbegin(); it != picked.cend(); it++)
+        {
+            pickedBits[*it / 64] |= static_cast<quint64>(1) << (*it % 64);
+        }
+        for (auto it = order->cbegin(); it != order->cend(); it++)
+        {
+            if ((pickedBits[*it / 64] >> (*it % 64)) & 1)
+            {
+                out.push_back(rows[*it]);
+            }
+        }
+        return;
+    }
+
+    for (auto it = picked.cbegin(); it != picked.cend(); it++)
+    {
+        out.push_back(rows[*it]);
+    }
+    if (!sortKeys.isEmpty())
+    {
+        if (cache)
+        {
+            QMutexLocker locker(&cache->sortLock);
+            sortRecords(out, sortKeys, &cache->sortKeys);
+        }
+        else
+        {
+            sortRecords(out, sortKeys);
+        }
+    }
+}
+
+
+QStringList teamFieldNames()
+{
+    QStringList names;
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        names.append(columnName(static_cast<Column>(column)));
+    }
+    return names;
+}
+
+
+void teamFields(const TeamRecord& record, QueryRow& out)
+{
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        out.add(fieldValue(record, static_cast<Column>(column)), isNumericColumn(static_cast<Column>(column)));
+    }
+}
+
+
+// The names of the values groupFields writes out, starting with the columns
+// the groups are grouped by.
+QStringList groupFieldNames(Column first, int second)
+{
+    QStringList names;
+    names << columnName(first);
+    if (second > -1)
+    {
+        names << columnName(static_cast<Column>(second));
+    }
+    names << "Teams" << "Stadiums" << "Total Capacity" << "Average Capacity" << "Smallest Capacity" << "Largest Capacity"
+          << "Oldest Stadium" << "Oldest Year" << "Newest Stadium" << "Newest Year";
+    return names;
+}
+
+
+void groupFields(const GroupTotals& group, int second, QueryRow& out)
+{
+    out.add(group.first, false);
+    if (second > -1)
+    {
+        out.add(group.second, false);
+    }
+    out.add(QString::number(group.teams), true);
+    out.add(QString::number(group.stadiums), true);
+    out.add(QString::number(group.totalCapacity), true);
+    out.add(QString::number(group.averageCapacity(), 'f', 1), true);
+    out.add(QString::number(group.smallestCapacity), true);
+    out.add(QString::number(group.largestCapacity), true);
+    out.add(group.oldestStadium, false);
+    out.add(QString::number(group.oldestYear), true);
+    out.add(group.newestStadium, false);
+    out.add(QString::number(group.newestYear), true);
+}
+
+
+// Quotes :param text: for a CSV file if it needs it.
+QString csvField(const QString& text)
+{
+    bool quote = false;
+    for (int i = 0; i < text.size() && !quote; i++)
+    {
+        quote = text[i] == ',' || text[i] == '"' || text[i] == '\n' || text[i] == '\r';
+    }
+    if (!quote)
+    {
+        return text;
+    }
+
+    QString quoted = "\"";
+    for (int i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '"')
+        {
+            quoted += '"';
+        }
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+
+// Turns :param text: into a JSON string, quotes and all.
+QString jsonString(const QString& text)
+{
+    QString quoted = "\"";
+    for (int i = 0; i < text.size(); i++)
+    {
+        const QChar letter = text[i];
+        if (letter == '"' || letter == '\\')
+        {
+            quoted += '\\';
+            quoted += letter;
+        }
+        else if (letter == '\n')
+        {
+            quoted += "\\n";
+        }
+        else if (letter == '\r')
+        {
+            quoted += "\\r";
+        }
+        else if (letter == '\t')
+        {
+            quoted += "\\t";
+        }
+        else if (letter.unicode() < 0x20)
+        {
+            quoted += QString("\\u%1").arg(letter.unicode(), 4, 16, QChar('0'));
+        }
+        else
+        {
+            quoted += letter;
+        }
+    }
+    return quoted + "\"";
+}
+
+
+// Writes out a row as a JSON object, with its values in the order of
+// :param names: rather than sorted by name like QJsonObject would.
+QString jsonObject(const QStringList& names, const QueryRow& row)
+{
+    QStringList fields;
+    for (int i = 0; i < row.values.size(); i++)
+    {
+        fields.append(jsonString(names[i]) + ": " + (row.numbers[i] ? row.values[i] : jsonString(row.values[i])));
+    }
+    return "{" + fields.join(", ") + "}";
+}
@@ -0,0 +1,249 @@
+#include "teamrecord.h"
+#include <QLocale>
+#include <iterator>
+#include <limits>
+
+
+namespace
+{
+    // Parses a whole number that may have commas in it (like "63,400"). Returns
+    // false if it isn't a number or it is bigger than :param max:.
+    bool parseNumber(std::string_view text, unsigned long long max, unsigned long long& out)
+    {
+        bool foundDigit = false;
+        out = 0;
+
+        for (auto it = text.begin(); it != text.end(); it++)
+        {
+            if (*it == ',')
+            {
+                continue;
+            }
+            if (*it < '0' || *it > '9')
+            {
+                return false;
+            }
+            out = out * 10 + (*it - '0');
+            if (out > max)
+            {
+                return false;
+            }
+            foundDigit = true;
+        }
+        return foundDigit;
+    }
+
+    QString fieldToString(const std::string_view& field)
+    {
+        return QString::fromUtf8(field.data(), static_cast<int>(field.size()));
+    }
+
+    bool encodeField(const std::vector<std::string_view>& fields, Column column, DictionaryCode& out, QString* error)
+    {
+        if (!columnDictionary(column).encode(fields[static_cast<int>(column)], out))
+        {
+            if (error)
+            {
+                *error = QString("Invalid input: There are more than %1 different values in the %2 column.").arg(Dictionary::MAX_SIZE).arg(columnName(column));
+            }
+            return false;
+        }
+        return true;
+    }
+
+    // The names that can be used for each column, for typing them in. Spaces
+    // and underscores are left out of the names before they are looked up here.
+    struct ColumnAlias
+    {
+        const char* name;
+        Column column;
+    };
+
+    const ColumnAlias COLUMN_ALIASES[] = {
+        {"team", Column::TeamName},
+        {"teamname", Column::TeamName},
+        {"stadium", Column::StadiumName},
+        {"stadiumname", Column::StadiumName},
+        {"capacity", Column::SeatingCapacity},
+        {"seatingcapacity", Column::SeatingCapacity},
+        {"city", Column::City},
+        {"state", Column::State},
+        {"conference", Column::Conference},
+        {"division", Column::Division},
+        {"surface", Column::SurfaceType},
+        {"surfacetype", Column::SurfaceType},
+        {"roof", Column::RoofType},
+        {"rooftype", Column::RoofType},
+        {"stadiumrooftype", Column::RoofType},
+        {"year", Column::YearOpened},
+        {"opened", Column::YearOpened},
+        {"yearopened", Column::YearOpened},
+        {"dateopened", Column::YearOpened}
+    };
+}
+
+
+// Gets the text shown in the table for one of the columns.
+QString TeamRecord::text(Column column) const
+{
+    return visitColumn(column, [this](auto constant) -> QString
+    {
+        constexpr Column current = decltype(constant)::value;
+        typedef ColumnTraits<current> Traits;
+
+        if constexpr (Traits::numeric)
+        {
+            static const QLocale english(QLocale::English);
+            return Traits::grouped ? english.toString(get<current>(*this)) : QString::number(get<current>(*this));
+        }
+        else if constexpr (Traits::encoded)
+        {
+            return columnDictionary(current).text(get<current>(*this));
+        }
+        else
+        {
+            return get<current>(*this);
+        }
+    });
+}
+
+
+// Fills in :param out: from the entries of one line of a csv file. Returns false
+// (with the reason in :param error: if it was given) if there are not exactly
+// COLUMN_COUNT entries, the numbers aren't numbers or one of the dictionaries
+// is full.
+bool TeamRecord::fromFields(const std::vector<std::string_view>& fields, TeamRecord& out, QString* error)
+{
+    unsigned long long capacity = 0;
+    unsigned long long year = 0;
+
+    if (fields.size() != COLUMN_COUNT)
+    {
+        if (error)
+        {
+            *error = QString("Invalid input: All lines must have %1 entries, but %2 were found.").arg(COLUMN_COUNT).arg(fields.size());
+        }
+        return false;
+    }
+
+    if (!parseNumber(fields[static_cast<int>(Column::SeatingCapacity)], std::numeric_limits<quint32>::max(), capacity))
+    {
+        if (error)
+        {
+            *error = QString("Invalid input: \"%1\" is not a valid seating capacity.").arg(fieldToString(fields[static_cast<int>(Column::SeatingCapacity)]));
+        }
+        return false;
+    }
+
+    if (!parseNumber(fields[static_cast<int>(Column::YearOpened)], std::numeric_limits<quint16>::max(), year))
+    {
+        if (error)
+        {
+            *error = QString("Invalid input: \"%1\" is not a valid year.").arg(fieldToString(fields[static_cast<int>(Column::YearOpened)]));
+        }
+        return false;
+    }
+
+    out.teamName = fieldToString(fields[static_cast<int>(Column::TeamName)]);
+    out.stadiumName = fieldToString(fields[static_cast<int>(Column::StadiumName)]);
+    out.seatingCapacity = static_cast<quint32>(capacity);
+    out.city = fieldToString(fields[static_cast<int>(Column::City)]);
+    out.state = fieldToString(fields[static_cast<int>(Column::State)]);
+    out.yearOpened = static_cast<quint16>(year);
+
+    if (!encodeField(fields, Column::Conference, out.conference, error) ||
+        !encodeField(fields, Column::Division, out.division, error) ||
+        !encodeField(fields, Column::SurfaceType, out.surfaceType, error) ||
+        !encodeField(fields, Column::RoofType, out.roofType, error))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+const char* columnName(Column column)
+{
+    return visitColumn(column, [](auto constant)
+    {
+        return ColumnTraits<decltype(constant)::value>::name;
+    });
+}
+
+
+bool isNumericColumn(Column column)
+{
+    return visitColumn(column, [](auto constant)
+    {
+        return ColumnTraits<decltype(constant)::value>::numeric;
+    });
+}
+
+
+bool isEncodedColumn(Column column)
+{
+    return visitColumn(column, [](auto constant)
+    {
+        return ColumnTraits<decltype(constant)::value>::encoded;
+    });
+}
+
+
+/*
+ * Finds the column called :param name: (ignoring case, spaces and
+ * underscores), which can be its full name or a shorter one like "capacity" or
+ * "roof", and puts it in :param out:. Returns false if no column is called that.
+ */
+bool findColumn(QString name, Column& out)
+{
+    name = name.toLower();
+    name.remove(' ');
+    name.remove('_');
+    for (auto alias = std::begin(COLUMN_ALIASES); alias != std::end(COLUMN_ALIASES); alias++)
+    {
+        if (name == alias->name)
+        {
+            out = alias->column;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+Dictionary& columnDictionary(Column column)
+{
+    // Only the encoded columns ever use theirs.
+    static Dictionary dictionaries[COLUMN_COUNT];
+    return dictionaries[static_cast<int>(column)];
+}
+
+
+int compareColumn(const TeamRecord& first, const TeamRecord& second, Column column)
+{
+    return visitColumn(column, [&first, &second](auto constant) -> int
+    {
+        constexpr Column current = decltype(constant)::value;
+        const auto& firstValue = get<current>(first);
+        const auto& secondValue = get<current>(second);
+
+        if constexpr (ColumnTraits<current>::numeric)
+        {
+            return (firstValue < secondValue) ? -1 : (secondValue < firstValue ? 1 : 0);
+        }
+        else if constexpr (ColumnTraits<current>::encoded)
+        {
+            if (firstValue == secondValue)
+            {
+                return 0;
+            }
+            const Dictionary& dictionary = columnDictionary(current);
+            return QString::localeAwareCompare(dictionary.text(firstValue), dictionary.text(secondValue));
+        }
+        else
+        {
+            return QString::localeAwareCompare(firstValue, secondValue);
+        }
+    });
+}
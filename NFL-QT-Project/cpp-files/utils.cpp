@@ -1,6 +1,6 @@
 #include "utils.h"
 #include "csv.h"
-#include <QMessageBox>
+#include <QHash>
 #include <algorithm>
 
 
@@ -57,57 +57,146 @@ unsigned long long qvarToULongLong(QVariant var, bool* okay)
 }
 
 
-bool loadRowsFromFile(std::string path, QVector<std::array<QTableWidgetItem*, 10>>& out)
+/*
+ * Reads every team in the file at :param path: and adds them to :param out:.
+ * Nothing is added unless the whole file is good. This doesn't touch the GUI,
+ * so it can be run on any thread. If it fails, false is returned and
+ * :param error: (if given) says why. :param progress: (if given) is called
+ * about once for every percent of the file that is read, and can stop the read
+ * by returning false.
+ */
+bool readRowsFromFile(const std::string& path, QVector<TeamRecord>& out, LoadError* error, const LoadProgress& progress)
 {
-    std::vector<std::vector<std::string>> fileData;
+    // Records are built while the file is being read, but they are only added
+    // to `out` once we know the whole file is good.
+    QVector<TeamRecord> records;
     std::size_t tokens = 0;
+    LoadError failure;
 
     try
     {
-        // Read the CSV file in strict mode.
-        tokens = csv::readFile(path, fileData, 0, true);
+        csv::MappedFile file(path.c_str());
+        const std::size_t total = file.view().size();
+        const std::size_t step = std::max<std::size_t>(total / 100, 1);
+        std::size_t nextReport = 0;
+
+        // Read the CSV file in strict mode, one line at a time. Big files
+        // (like multi-season imports) get split up between every core.
+        tokens = csv::readBufferParallel(file.view(), [&](std::size_t line, std::size_t offset, const std::vector<std::string_view>& fields)
+        {
+            if (progress && offset >= nextReport)
+            {
+                nextReport = offset + step;
+                if (!progress(offset, total))
+                {
+                    failure.kind = LoadError::Cancelled;
+                    failure.message = "Loading the file was cancelled.";
+                    return false;
+                }
+            }
+
+            TeamRecord& record = records.emplace_back();
+
+            // Stop at the first line that isn't a valid team. This also catches
+            // a first line of the wrong width, which strict mode would otherwise
+            // let through since every other line gets compared to it.
+            if (!TeamRecord::fromFields(fields, record, &failure.message))
+            {
+                failure.kind = LoadError::BadRecord;
+                failure.line = line + 1;
+                failure.message += QString(" (line %1)").arg(line + 1);
+                return false;
+            }
+            return true;
+        }, 0, true);
     }
     catch (csv::FileError e)
     {
-        QMessageBox::critical(nullptr, "Error", "Could not find the specified file.");
-        return false;
+        failure.kind = LoadError::FileNotFound;
+        failure.message = "Could not find the specified file.";
     }
     catch (csv::UnclosedQuoteError e)
     {
-        QMessageBox::critical(nullptr, "Error", "Invalid input: expected a close to the open quote found.");
-        return false;
+        failure.kind = LoadError::BadFormat;
+        failure.message = "Invalid input: expected a close to the open quote found.";
     }
     catch (csv::UnexpectedCharacterError e)
     {
-        QMessageBox::critical(nullptr, "Error", "Invalid input: unexpected character in file.");
-        return false;
+        failure.kind = LoadError::BadFormat;
+        failure.message = "Invalid input: unexpected character in file.";
     }
     catch (csv::UnexpectedEndOfStreamError e)
     {
-        QMessageBox::critical(nullptr, "Error", "Invalid input: file ended when more data was expected.");
-        return false;
+        failure.kind = LoadError::BadFormat;
+        failure.message = "Invalid input: file ended when more data was expected.";
     }
     catch (std::length_error)
     {
-        QMessageBox::critical(nullptr, "Error", "Invalid input: number of tokens per line do not match.");
-        return false;
+        failure.kind = LoadError::BadFormat;
+        failure.message = "Invalid input: number of tokens per line do not match.";
     }
 
-    if (tokens != 10)
+    if (failure.kind == LoadError::None && tokens != COLUMN_COUNT)
     {
-        QMessageBox::critical(nullptr, "Error", QString::fromStdString("Invalid input: All lines must have 10 entries, but only " + std::to_string(tokens) + " were found."));
-        return false;
+        failure.kind = LoadError::BadFormat;
+        failure.message = QString::fromStdString("Invalid input: All lines must have " + std::to_string(COLUMN_COUNT) + " entries, but only " + std::to_string(tokens) + " were found.");
     }
 
-    for (auto row = fileData.begin(); row != fileData.end(); row++)
+    if (failure.kind != LoadError::None)
     {
-        out.emplace_back();
-        for (int column = 0; column < 10; column++)
+        if (error)
         {
-            out.back()[column] = new QTableWidgetItem;
-            out.back()[column]->setData(0, QVariant(QString::fromStdString((*row)[column])));
+            *error = failure;
         }
+        return false;
     }
 
+    out.append(records);
+
     return true;
 }
+
+
+
+/*
+ * Adds the teams in :param readEntries: that aren't in :param teamNames: yet
+ * to :param updates:, and their names to :param teamNames:. Teams that are in
+ * :param readEntries: more than once are only added the first time, and their
+ * names are put in :param duplicates: (if given).
+ */
+void mergeUpdates(const QVector<TeamRecord>& readEntries, QSet<QString>& teamNames, QVector<TeamRecord>& updates, QStringList* duplicates)
+{
+    // The names seen so far in this file, and whether they have been reported
+    // as duplicates yet.
+    QHash<QString, bool> namesInFile;
+    namesInFile.reserve(readEntries.size());
+    teamNames.reserve(teamNames.size() + readEntries.size());
+
+    if (duplicates)
+    {
+        duplicates->clear();
+    }
+
+    for (auto it = readEntries.cbegin(); it != readEntries.cend(); it++)
+    {
+        auto found = namesInFile.find(it->teamName);
+        if (found != namesInFile.end())
+        {
+            if (duplicates && !found.value())
+            {
+                duplicates->append(it->teamName);
+            }
+            found.value() = true;
+            continue;
+        }
+        namesInFile.insert(it->teamName, false);
+
+        // If the team isn't already in one of the lists, then add it to the
+        // updates.
+        if (!teamNames.contains(it->teamName))
+        {
+            teamNames.insert(it->teamName);
+            updates.push_back(*it);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CAPACITYAGGREGATE_H
+#define CAPACITYAGGREGATE_H
+
+#include <QHash>
+#include <QString>
+#include "teamrecord.h"
+
+// Keeps the total seating capacity of a set of teams up to date as teams are
+// added to and removed from it. Teams that share a stadium only count it once,
+// so each stadium remembers how many of the teams use it and the capacity is
+// only taken away when the last of them is removed.
+class CapacityAggregate
+{
+public:
+    CapacityAggregate();
+
+    bool add(const TeamRecord& record);
+    void remove(const TeamRecord& record);
+    void clear();
+
+    unsigned long long total() const;
+    int stadiumCount() const;
+
+private:
+    struct Stadium
+    {
+        int teams;
+        // The capacity of the first team added with this stadium.
+        quint32 capacity;
+    };
+
+    QHash<QString, Stadium> stadiums;
+    unsigned long long runningTotal;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef COMPLETIONINDEX_H
+#define COMPLETIONINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+#include "teamrecord.h"
+
+// The columns that are offered as completions while typing a search.
+const Column COMPLETION_COLUMNS[] = {Column::TeamName, Column::StadiumName, Column::City, Column::State};
+
+// Finds the values of the completion columns that start with what has been
+// typed so far, ignoring case, the most used ones first. The values are kept in
+// a prefix tree where each node only has one child per letter and runs of
+// letters without a choice are stored as one node. Every node keeps its own
+// best few values, kept up to date as values are added, so finding the
+// completions only has to follow the typed letters down the tree and never
+// looks at the values under the node it ends up at.
+class CompletionIndex
+{
+public:
+    // The most completions that can be asked for.
+    static const int TOP_COUNT = 8;
+
+    CompletionIndex();
+
+    void add(const TeamRecord& record);
+    void clear();
+
+    void complete(const QString& prefix, int limit, QStringList& out) const;
+private:
+    struct Value
+    {
+        // The text as it was first seen, and folded to one case.
+        QString text;
+        QString key;
+        // How many times it has been added.
+        int count;
+    };
+
+    struct Node
+    {
+        // The letters leading to this node from its parent, as a part of the
+        // key of one of the values under it.
+        int edgeValue;
+        int edgeStart;
+        int edgeLength;
+        // The children are kept in order of their first letter.
+        int firstChild;
+        int nextSibling;
+        // The best values under this node (including itself), best first.
+        int topCount;
+        int top[TOP_COUNT];
+    };
+
+    void addValue(const QString& text);
+    int insert(int value);
+    int findChild(int node, QChar letter) const;
+    QChar edgeLetter(const Node& node, int i) const;
+    void promote(int node, int value);
+    bool better(int first, int second) const;
+
+    QVector<Value> values;
+    // Each value's key and where it is in values.
+    QHash<QString, int> ids;
+    // Every node of the tree, starting with the root.
+    std::vector<Node> nodes;
+    // The nodes from the root to the last value that was added to.
+    std::vector<int> path;
+};
+
+#endif
@@ -2,9 +2,13 @@
 #ifndef __DESTRUCTION_CSV_H__
 #define __DESTRUCTION_CSV_H__
 
+#include <deque>
+#include <functional>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <stdexcept>
+#include "mappedfile.h"
 
 namespace csv
 {
@@ -14,6 +18,38 @@ namespace csv
     std::size_t readFile(std::string fileName, std::vector<std::vector<std::string>>& output, std::size_t lineCount = 0, bool strict = false);
     std::size_t readFile(const char* fileName, std::vector<std::vector<std::string>>& output, std::size_t lineCount = 0, bool strict = false);
 
+    // A parsed csv file whose fields point straight into the mapped file. Only
+    // fields that had to be unescaped are copied, and those copies are kept in
+    // `unescaped` so every view in `rows` stays valid as long as the Document.
+    struct Document
+    {
+        MappedFile file;
+        std::deque<std::string> unescaped;
+        std::vector<std::vector<std::string_view>> rows;
+    };
+
+    std::size_t readLine(std::string_view& input, std::vector<std::string_view>& output, std::deque<std::string>& unescaped, const char sep = ',');
+    std::size_t readBuffer(std::string_view input, std::vector<std::vector<std::string_view>>& output, std::deque<std::string>& unescaped, std::size_t lineCount = 0, bool strict = false);
+
+    std::size_t readFile(std::string fileName, Document& output, std::size_t lineCount = 0, bool strict = false);
+    std::size_t readFile(const char* fileName, Document& output, std::size_t lineCount = 0, bool strict = false);
+
+    // Called for every line read by the streaming readers with the number of
+    // the line (starting at 0), the offset in the input where the next line
+    // starts, and the line's entries. The entries are only valid until the
+    // visitor returns. Returning false stops the reader.
+    typedef std::function<bool(std::size_t line, std::size_t offset, const std::vector<std::string_view>& fields)> RowVisitor;
+
+    std::size_t readBuffer(std::string_view input, const RowVisitor& visitor, std::size_t lineCount = 0, bool strict = false);
+
+    std::size_t readFile(std::string fileName, const RowVisitor& visitor, std::size_t lineCount = 0, bool strict = false);
+    std::size_t readFile(const char* fileName, const RowVisitor& visitor, std::size_t lineCount = 0, bool strict = false);
+
+    std::size_t readBufferParallel(std::string_view input, const RowVisitor& visitor, std::size_t lineCount = 0, bool strict = false, std::size_t threads = 0);
+
+    std::size_t readFileParallel(std::string fileName, const RowVisitor& visitor, std::size_t lineCount = 0, bool strict = false, std::size_t threads = 0);
+    std::size_t readFileParallel(const char* fileName, const RowVisitor& visitor, std::size_t lineCount = 0, bool strict = false, std::size_t threads = 0);
+
     class CSVException : public std::logic_error
     {
     public:
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef __DESTRUCTION_CSVSCAN_H__
+#define __DESTRUCTION_CSVSCAN_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace csv
+{
+    // The different ways the scanner can look for structural characters. The
+    // best one the processor supports is picked the first time it is needed.
+    enum class ScanKernel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    ScanKernel scanKernel();
+    void setScanKernel(ScanKernel kernel);
+    bool scanKernelSupported(ScanKernel kernel);
+    const char* scanKernelName(ScanKernel kernel);
+
+    // Finds the characters the csv parser actually has to look at: quotes, and
+    // separators, '\r' and '\n' that are not inside a quoted entry. Everything
+    // else is plain text that can be taken in one go. The input is scanned 64
+    // bytes at a time with a bit mask of which bytes are inside quotes, so the
+    // parser never has to look at the text between two structural characters.
+    class StructuralScanner
+    {
+    public:
+        StructuralScanner(std::string_view input, char sep = ',');
+
+        // Returns the offset of the next structural character, or the size of
+        // the input when there are none left.
+        std::size_t next();
+
+    private:
+        void refill();
+
+        std::string_view input;
+        char sep;
+        // How many bytes of the input have been scanned so far.
+        std::size_t scanned;
+        // All ones if the last scanned byte was inside of a quoted entry.
+        std::uint64_t inQuotes;
+        // How many bytes to scan the next time we run out. Starts small so
+        // reading a single line doesn't scan far past it, and grows from there.
+        std::size_t window;
+        std::vector<std::size_t> found;
+        std::size_t index;
+    };
+}
+
+#endif
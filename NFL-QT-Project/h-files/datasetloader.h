@@ -0,0 +1,64 @@
+#ifndef DATASETLOADER_H
+#define DATASETLOADER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "snapshot.h"
+#include "sort.h"
+#include "teamrecord.h"
+#include "utils.h"
+
+// A file of teams read by a DatasetLoader. If anything went wrong, records is
+// empty and error says what. If the teams came from the file's snapshot,
+// orders has the sorted orders that were saved with them.
+struct LoadResult
+{
+    QString path;
+    QVector<TeamRecord> records;
+    SortedOrderCache orders;
+    LoadError error;
+};
+
+// Reads files of teams on another thread so the window doesn't freeze while a
+// big file is read. Only one file is read at a time. progressChanged is sent
+// as the file is read and finished once it is done, both on the thread the
+// loader lives on. The records are only handed over (by result) once the
+// whole file has been read, so the table never sees half of a file.
+//
+// A file can be loaded with its snapshot, which is read instead of the file if
+// the file hasn't changed since the snapshot was made. Otherwise the file is
+// read and a new snapshot is made from it afterwards, on yet another thread.
+class DatasetLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DatasetLoader(QObject *parent = nullptr);
+    ~DatasetLoader();
+
+    bool load(const QString& path, bool snapshot = false);
+    bool isLoading() const;
+    LoadResult result() const;
+public slots:
+    void cancel();
+signals:
+    void progressChanged(int percent);
+    void finished();
+private slots:
+    void readFinished();
+private:
+    QFutureWatcher<LoadResult> watcher;
+    // Stays set until finished is sent, which can be after the thread is done.
+    bool loading;
+    // Set to stop the file that is being read.
+    std::atomic<bool> cancelled;
+    // Whether a snapshot should be made of the file being read, and what the
+    // file looked like before it was read (set by the thread reading it).
+    bool makeSnapshot;
+    SnapshotSource source;
+    QFuture<void> snapshotWriter;
+};
+
+#endif
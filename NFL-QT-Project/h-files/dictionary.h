@@ -0,0 +1,59 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <string_view>
+
+// The small number a dictionary gives to each of the different values it has
+// seen.
+typedef quint16 DictionaryCode;
+
+// Gives every different value of a column its own code so that rows only have
+// to store the code. The conference, division, surface and roof columns only
+// have a handful of values between all of the teams, so this saves having a
+// separate copy of the same text in every row and lets filters compare codes
+// instead of strings.
+//
+// Codes are never removed or reused, so a code stays valid for as long as the
+// program runs. Adding values is locked, but looking up the text of a code is
+// not, so the table can be drawn while a file is being loaded.
+class Dictionary
+{
+public:
+    // The most values a dictionary can hold.
+    static const int MAX_SIZE = 65536;
+
+    Dictionary();
+    ~Dictionary();
+
+    Dictionary(const Dictionary&) = delete;
+    Dictionary& operator=(const Dictionary&) = delete;
+
+    bool encode(std::string_view text, DictionaryCode& out);
+    bool encode(const QString& text, DictionaryCode& out);
+    bool find(const QString& text, DictionaryCode& out) const;
+
+    const QString& text(DictionaryCode code) const;
+    int size() const;
+
+private:
+    bool insert(const QByteArray& key, DictionaryCode& out);
+
+    // The text of each code is kept in blocks that never move once they are
+    // made, which is what lets text() read them without the lock.
+    static const int BLOCK_SIZE = 256;
+    static const int BLOCK_COUNT = MAX_SIZE / BLOCK_SIZE;
+
+    std::atomic<QString*> blocks[BLOCK_COUNT];
+    std::atomic<int> count;
+
+    mutable QMutex lock;
+    QHash<QByteArray, DictionaryCode> codes;
+};
+
+#endif
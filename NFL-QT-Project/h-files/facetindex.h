@@ -0,0 +1,36 @@
+#ifndef FACETINDEX_H
+#define FACETINDEX_H
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include "teamrecord.h"
+
+// The columns that only have a few different values between all of the teams,
+// so the table can be narrowed down to one of them from a menu.
+const Column FACET_COLUMNS[] = {Column::Conference, Column::Division, Column::SurfaceType, Column::RoofType, Column::State};
+
+bool isFacetColumn(Column column);
+
+// Keeps the different values of each of the facet columns up to date as rows
+// are added, along with which rows have each value. Rows are never taken away
+// one at a time; the table clears the index and adds them all again when its
+// rows change. Getting the values for a menu then only has to go through the
+// values, and narrowing the table down to one value only has to go through the
+// rows that have it.
+class FacetIndex
+{
+public:
+    void add(const TeamRecord& record, int row);
+    void clear();
+
+    void values(Column column, int rowLimit, QVector<QString>& out) const;
+    const QVector<int>* rows(Column column, const QString& value) const;
+
+private:
+    // For each column, the rows that have each value, from the first row to
+    // the last. Only the facet columns are used.
+    QMap<QString, QVector<int>> index[COLUMN_COUNT];
+};
+
+#endif
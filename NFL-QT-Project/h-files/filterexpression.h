@@ -0,0 +1,88 @@
+#ifndef FILTEREXPRESSION_H
+#define FILTEREXPRESSION_H
+
+#include <QString>
+#include <QVector>
+#include <vector>
+#include "teamrecord.h"
+
+// A filter typed in by the user, like
+//
+//     roof = "Retractable" AND capacity > 65000 OR division = "AFC West"
+//
+// Each comparison is a column, one of = != < <= > >= and a number or some
+// quoted text. Text is compared ignoring case. Comparisons can be joined with
+// AND, OR and NOT (AND goes before OR) and grouped with brackets.
+//
+// The text is parsed into a tree, which is then compiled into a program where
+// every column and value is already worked out: numbers are compared as
+// numbers, and the encoded columns get a table of which of their codes pass, so
+// checking them never looks at any text. The rows are checked in batches, one
+// comparison at a time, with a bit for each row of the batch saying if it is
+// still selected. Each comparison only looks at the rows the ones before it
+// left for it, so the rows an AND has already ruled out (or an OR has already
+// let in) are skipped.
+class FilterExpression
+{
+public:
+    FilterExpression();
+
+    bool compile(const QString& text, QString* error = nullptr);
+    bool isEmpty() const;
+    const QString& text() const;
+    QString key() const;
+
+    void evaluate(const QVector<const TeamRecord*>& rows, int first, std::vector<quint64>& bits);
+private:
+    enum class Operator
+    {
+        Equal,
+        NotEqual,
+        Less,
+        LessOrEqual,
+        Greater,
+        GreaterOrEqual
+    };
+
+    // One step of the program.
+    struct Instruction
+    {
+        enum Kind
+        {
+            And,
+            Or,
+            Not,
+            Compare
+        };
+
+        Kind kind;
+        // The instructions that And and Or join, or the one Not flips.
+        QVector<int> children;
+
+        // What Compare compares.
+        Column column;
+        Operator op;
+        quint32 number;
+        QString text;
+        // For encoded columns, if each of the dictionary's codes passes.
+        std::vector<char> codes;
+    };
+
+    struct Node;
+    class Parser;
+
+    int compileNode(const Node& node, QString* error);
+    void writeKey(int instruction, QString& out) const;
+    void prepare();
+    void run(int instruction, const TeamRecord* const* rows, const quint64* mask, quint64* out) const;
+    void compare(const Instruction& instruction, const TeamRecord* const* rows, const quint64* mask, quint64* out) const;
+
+    static bool compareText(const QString& value, Operator op, const QString& text);
+
+    QString source;
+    QVector<Instruction> program;
+    // The instruction that gives the result, or -1 if there is no filter.
+    int root;
+};
+
+#endif
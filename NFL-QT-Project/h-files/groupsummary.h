@@ -0,0 +1,75 @@
+#ifndef GROUPSUMMARY_H
+#define GROUPSUMMARY_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "capacityaggregate.h"
+#include "teamrecord.h"
+
+// What the teams in one group of a GroupSummary add up to. Teams that share a
+// stadium only count it once, so the capacities are of the group's stadiums,
+// not its teams.
+struct GroupTotals
+{
+    // The group's value of the column it is grouped by, and of the second
+    // column (empty if there isn't one).
+    QString first;
+    QString second;
+
+    int teams;
+    int stadiums;
+    unsigned long long totalCapacity;
+    quint32 smallestCapacity;
+    quint32 largestCapacity;
+    // The stadiums that opened first and last, and when. The first one added
+    // is kept when they tie.
+    QString oldestStadium;
+    quint16 oldestYear;
+    QString newestStadium;
+    quint16 newestYear;
+
+    double averageCapacity() const;
+};
+
+// Splits the teams into groups by the value of one column, or of a pair of
+// columns (like conference and roof type), and adds up each group. Every row
+// is only looked at once: each one is put straight into its group with one hash
+// lookup, and rows added to the end later are added to the groups they belong
+// to without going over the others again.
+class GroupSummary
+{
+public:
+    explicit GroupSummary(Column first = Column::Conference, int second = -1);
+
+    void update(const QVector<const TeamRecord*>& rows);
+    void clear();
+
+    void groups(QVector<GroupTotals>& out) const;
+private:
+    struct Group
+    {
+        GroupTotals totals;
+        CapacityAggregate capacity;
+        // The values the group was keyed by, used to put numbers in order.
+        quint32 firstValue;
+        quint32 secondValue;
+    };
+
+    quint32 valueOf(const TeamRecord& record, Column column, int slot);
+    void add(const TeamRecord& record);
+
+    Column first;
+    // The second column, or -1 to only group by the first one.
+    int second;
+
+    // The groups, keyed by the values of both columns. Numbers key by their
+    // value, the encoded columns by their codes and text by the order it was
+    // first seen in, which is what textValues is for.
+    QHash<quint64, Group> groupsByKey;
+    QHash<QString, quint32> textValues[2];
+    // How many of the rows have been added.
+    int rowCount;
+};
+
+#endif
@@ -2,7 +2,17 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QCompleter>
 #include <QHeaderView>
+#include <QMenu>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QStringListModel>
+#include <QVector>
+#include "completionindex.h"
+#include "datasetloader.h"
+#include "queryservice.h"
+#include "teamrecord.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -36,12 +46,60 @@ private slots:
 
     void on_actionLoad_New_Entries_triggered();
 
-    void displayConference(QAction* action);
+    void displayFacet(QAction* action);
 
-    void redisplayConferenceMenu();
+    void on_searchEdit_textChanged(const QString& text);
+
+    void on_searchEdit_textEdited(const QString& text);
+
+    void displayRanges();
+
+    void on_actionFilter_Teams_triggered();
+
+    void on_actionSummary_triggered();
+
+    void redisplaySummary();
+
+    void redisplayFacetMenus();
+
+    void loadFinished();
+
+    void on_actionServe_Queries_toggled(bool checked);
+
+    void updateQueryService();
 
 private:
+    // One of the "Display ..." menus, the column it narrows the table down by, and the text of the action shown when the column has no values
+    struct FacetMenu
+    {
+        QMenu* menu;
+        Column column;
+        QString none;
+    };
+
+    void startLoading(const QString& path, bool original);
+
+    const FacetMenu* findFacetMenu(QMenu* menu) const;
+
+    void redisplayFacetMenu(const FacetMenu& facetMenu);
+
+    void displayRange(Column column, int minimum, int maximum);
+
     Ui::MainWindow* ui;
     QHeaderView* tableHeader;
+
+    // Reads the files of teams without freezing the window.
+    DatasetLoader* loader;
+    // Shown in the status bar while a file is being read.
+    QProgressBar* loadProgress;
+    QPushButton* cancelLoadButton;
+    // Offers names that start with what has been typed into the search box.
+    QCompleter* searchCompleter;
+    QStringListModel* searchCompletions;
+    QVector<FacetMenu> facetMenus;
+    // Answers queries about the teams from other programs on this computer, while Serve Queries is checked.
+    QueryService* queryService;
+    // True if the file being read is the original list, false if it is new entries.
+    bool loadingOriginal;
 };
 #endif
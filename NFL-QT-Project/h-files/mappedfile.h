@@ -0,0 +1,44 @@
+#pragma once
+#ifndef __DESTRUCTION_MAPPEDFILE_H__
+#define __DESTRUCTION_MAPPEDFILE_H__
+
+#include <cstddef>
+#include <string_view>
+
+namespace csv
+{
+    // A read-only view of an entire file mapped into memory. The contents stay
+    // valid for as long as the MappedFile is alive, so any std::string_view
+    // taken from `view()` must not outlive it.
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        explicit MappedFile(const char* fileName);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        void open(const char* fileName);
+        void close();
+
+        bool isOpen() const;
+        std::string_view view() const;
+
+    private:
+        void swap(MappedFile& other) noexcept;
+
+        const char* data;
+        std::size_t size;
+        bool opened;
+#ifdef _WIN32
+        void* fileHandle;
+        void* mappingHandle;
+#endif
+    };
+}
+
+#endif
@@ -2,48 +2,160 @@
 #define NFLDATATABLE_H
 
 #include <QWidget>
-#include <QTableWidget>
-#include <array>
+#include <QTableView>
+#include <QSet>
+#include <QStringList>
 #include <QVector>
+#include <utility>
+#include <vector>
+#include "capacityaggregate.h"
+#include "completionindex.h"
+#include "facetindex.h"
+#include "filterexpression.h"
+#include "groupsummary.h"
+#include "nfltablemodel.h"
+#include "searchindex.h"
+#include "sort.h"
+#include "teamrecord.h"
 
 
 
-class NFLDataTable : public QTableWidget
+class NFLDataTable : public QTableView
 {
     Q_OBJECT
 public:
-    typedef std::array<QTableWidgetItem*, 10> ROW;
+    // Holds back listsUpdated and displayUpdated while it is alive, so that a
+    // batch of changes only sends each of them once, when the last scope ends.
+    class ChangeScope
+    {
+    public:
+        explicit ChangeScope(NFLDataTable* table);
+        ~ChangeScope();
+
+        ChangeScope(const ChangeScope&) = delete;
+        ChangeScope& operator=(const ChangeScope&) = delete;
+    private:
+        NFLDataTable* table;
+    };
 
     explicit NFLDataTable(QWidget *parent = nullptr);
     void showOriginalList();
     void showUpdatedList();
-    void loadOriginalList(QVector<ROW>& originalList);
+    void loadOriginalList(QVector<TeamRecord>& originalList, const SortedOrderCache* orders = nullptr);
     void loadOriginalData(QString path);
     void displayConference(QString conference);
-    void loadUpdateData(QString path);
+    void displayFacet(Column column, QString value);
+    void displaySearch(QString text);
+    void displayRange(Column column, quint32 minimum, quint32 maximum);
+    void clearRange(Column column);
+    bool displayExpression(const QString& text, QString* error = nullptr);
+    const QString& getExpression() const;
+    void loadUpdateData(QString path, QStringList* duplicates = nullptr);
+    void addUpdates(const QVector<TeamRecord>& readEntries, QStringList* duplicates = nullptr);
 
-    void addRow(ROW& row);
+    void addRow(const TeamRecord& row);
 
     unsigned long long getTotalCapacity() const;
+    const QVector<TeamRecord>& getOriginalList() const;
+    const QVector<TeamRecord>& getUpdates() const;
 
     void getConferences(QVector<QString>& out);
+    void getFacetValues(Column column, QVector<QString>& out) const;
+    void getCompletions(const QString& prefix, int limit, QStringList& out) const;
+    void getGroupTotals(Column first, int second, QVector<GroupTotals>& out);
 protected:
-    void redisplayData();
+    // Only shows the teams with a value of column from minimum to maximum.
+    struct NumberRange
+    {
+        Column column;
+        quint32 minimum;
+        quint32 maximum;
+    };
+
     void redisplaySorted();
+    void showAddedRows(int firstNew);
+    void originalListChanged(const SortedOrderCache* orders = nullptr);
+    void indexTeamNames();
+    void indexRows();
+    bool inView(int index) const;
+    bool passesFilters(int index) const;
+    void evaluateExpression(int firstRow);
+    QVector<int> viewRows();
+    void filteredRows(QVector<int>& out);
+    std::pair<const int*, const int*> rangeSlice(const NumberRange& range, const std::vector<int>& order, bool ascending) const;
+    void searchRows(QVector<int>& out);
+    void markListsChanged();
+    void markDisplayChanged();
+    void queueFlush();
 public Q_SLOTS:
     void sort(int column);
+private Q_SLOTS:
+    void rowsLeavingView(const QModelIndex& parent, int first, int last);
+    void rowsEnteredView(const QModelIndex& parent, int first, int last);
+    void viewReset();
+    void flushChanges();
 signals:
     void displayUpdated();
     void listsUpdated();
 private:
-    QVector<ROW> originalList;
-    QVector<ROW> updates;
-    QVector<ROW> displayData;
+    QVector<TeamRecord> originalList;
+    QVector<TeamRecord> updates;
+    // Every record, first the ones from originalList and then the ones from
+    // updates. The sorted orders are indexes into this.
+    QVector<const TeamRecord*> rows;
+    // Which of the rows are shown, in the order they are shown in.
+    NFLTableModel* tableModel;
+    // The name of every team in originalList and updates, so finding out if
+    // a team is already loaded doesn't need to go through both lists.
+    QSet<QString> teamNames;
+    // The total capacity of the teams in the view.
+    CapacityAggregate displayCapacity;
+    // The different values of the facet columns and which rows have them.
+    FacetIndex facets;
+    // The names of the teams, stadiums, cities and states, for completing searches.
+    CompletionIndex completions;
+    // The group summaries that have been asked for, keyed by the columns they
+    // group by. They catch up with the rows added since they were last used
+    // when they are next asked for.
+    QHash<int, GroupSummary> summaries;
+    SortKeyCache sortKeys;
+    SortedOrderCache sortedOrders;
     
     bool originalLoaded;
     bool ascending;
     int lastColumn;
     bool onlyShowingOriginal;
+    // The facet column being narrowed down to, or -1 to show every team, and
+    // the value the teams shown have in it.
+    int facetColumn;
+    QString facetValue;
+    // Where the facet column is in a record and the code of the value, when
+    // it is an encoded column, or nullptr to compare the text.
+    DictionaryCode TeamRecord::* facetMember;
+    DictionaryCode facetCode;
+    // The number columns being narrowed down to a range of values, at most one
+    // range for each column.
+    QVector<NumberRange> ranges;
+    // The filter typed in by the user, a bit for each row saying if it passes,
+    // and how many of them do.
+    FilterExpression expression;
+    std::vector<quint64> expressionBits;
+    int expressionCount;
+    // The text being searched for, or an empty string if the teams aren't
+    // being searched, and if the matches are shown best first. Sorting a
+    // column goes back to showing them in the order of the column.
+    SearchIndex search;
+    QString searchText;
+    bool searchRanked;
+
+    // How many ChangeScopes are open.
+    int changeDepth;
+    // If flushChanges has been queued up to run from the event loop.
+    bool flushQueued;
+    // What has changed since the signals were last sent.
+    bool listsChanged;
+    bool displayChanged;
+    bool sortIndicatorChanged;
 };
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef NFLTABLEMODEL_H
+#define NFLTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include "teamrecord.h"
+
+// The model behind NFLDataTable. It doesn't copy any of the records, it only
+// keeps a list of which records are shown (as indexes into the table's list of
+// every record) and makes the text of a cell when the view asks for it, which
+// it only does for the rows that are on screen.
+class NFLTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit NFLTableModel(const QVector<const TeamRecord*>& records, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    const TeamRecord* record(int row) const;
+    const QVector<int>& shownRecords() const;
+
+    void reorder(const QVector<int>& shown);
+    void filter(const QVector<int>& shown);
+    void insert(const QVector<int>& added, const QVector<int>& before);
+    void reset(const QVector<int>& shown);
+private:
+    const QVector<const TeamRecord*>& records;
+    QVector<int> shown;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Working on fewer rows than this isn't worth splitting up between threads.
+const int PARALLEL_MIN_ROWS = 65536;
+
+std::size_t defaultThreadCount();
+
+void runTasks(std::size_t tasks, std::size_t threads, const std::function<void(std::size_t)>& task);
+
+#endif
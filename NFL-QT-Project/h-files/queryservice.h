@@ -0,0 +1,73 @@
+#ifndef QUERYSERVICE_H
+#define QUERYSERVICE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QTcpServer>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "teamrecord.h"
+
+// Answers queries about the loaded teams over HTTP, so other programs on the
+// same computer don't each have to read the csv files themselves. It only
+// listens on localhost. Every request is a GET, and every answer is JSON:
+//
+//     /teams?filter=capacity > 65000&search=texas&sort=capacity:desc&offset=0&limit=10
+//     /summary?group=conference,roof&filter=roof = "Open"
+//
+// filter works like Filter Teams, search like the search box, and sort and
+// group take the same column names as nflquery. Adding list=original only
+// looks at the original list.
+//
+// Connections are accepted on the thread the service lives on, and read and
+// written on one I/O thread that is only woken up when a client sends or takes
+// something. The queries are answered on a pool of threads, so a slow query
+// never holds up the window or the other connections. Queries look at the
+// lists as they were when setLists was last called, which shares the records
+// with the caller rather than copying them. The answer to each different query
+// is kept until the lists change.
+class QueryService : public QTcpServer
+{
+    Q_OBJECT
+public:
+    static const quint16 DEFAULT_PORT = 8455;
+
+    explicit QueryService(QObject *parent = nullptr);
+    ~QueryService();
+
+    bool start(quint16 port = DEFAULT_PORT);
+    void stop();
+
+    void setLists(const QVector<TeamRecord>& originalList, const QVector<TeamRecord>& updates);
+
+    QByteArray respond(const QByteArray& target, int& status);
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+private:
+    class Connection;
+    class Answer;
+    struct Dataset;
+    struct Query;
+
+    std::shared_ptr<Dataset> currentDataset() const;
+
+    // The lists the queries are answered from. Replaced, never changed, so a
+    // query that is still using the last one can finish with it.
+    mutable QMutex datasetLock;
+    std::shared_ptr<Dataset> dataset;
+
+    // The thread the connections are read and written on, and the parent of
+    // the connections, which lives on it.
+    QThread ioThread;
+    QObject connections;
+    // The threads the queries are answered on.
+    QThreadPool pool;
+    // Set to make the connections close instead of reading another request.
+    std::atomic<bool> stopping;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
+#include "teamrecord.h"
+
+// A row that matched a search, and how closely.
+struct SearchMatch
+{
+    int row;
+    // How many letters have to be added, taken away or changed for the row to
+    // have the search text in it. 0 if it already does.
+    int distance;
+    // The first column that matched that closely.
+    Column column;
+};
+
+// Finds the rows that have some text in any of their text columns, ignoring
+// case and letting longer searches be a letter or two off. Every three letters
+// in a row (its trigrams) are indexed, so a search only has to look at the rows
+// that share enough of the search's trigrams to possibly match, and the
+// columns that only have a few different values are matched once per value
+// instead of once per row.
+//
+// Typing usually adds to the end of the last search, which can only match
+// fewer rows, so the results of the searches leading up to the current one are
+// kept and the next search only looks at the rows the last one matched.
+// Deleting letters goes back to the results that were already worked out. When
+// the next letter will let the search be more edits off, the rows that can
+// match with those edits are worked out in the background while waiting for
+// it, so that search doesn't have to go back to the whole index either.
+//
+// Rows are indexed on another thread as soon as they are added, and the index
+// keeps its own case folded copy of their text, so the records can change or
+// move once they have been added. Only one thread can use an index at a time.
+class SearchIndex
+{
+public:
+    // Searches shorter than this don't have any trigrams to look up, and would
+    // match too many rows to be any use anyway.
+    static const int MIN_LENGTH = 3;
+
+    SearchIndex();
+    ~SearchIndex();
+
+    void add(const QVector<const TeamRecord*>& rows, int first = 0);
+    int size() const;
+    const QVector<SearchMatch>& search(const QString& text);
+    void clear();
+
+    static int allowedEdits(int length);
+private:
+    struct Query;
+
+    // A row that could match a search, and which of its text columns could.
+    struct Candidate
+    {
+        int row;
+        quint8 fields;
+    };
+
+    // The matches for one search, in the order of the rows, and which of the
+    // text columns of each one matched as bits in the order of the columns.
+    struct Result
+    {
+        QString text;
+        int edits;
+        QVector<SearchMatch> matches;
+        std::vector<quint8> fields;
+    };
+
+    void indexAdded();
+    void index(std::vector<QString>& text, std::vector<DictionaryCode>& codes);
+    void finishIndexing();
+    void widen(const QString& text, int edits);
+    void finishWidening();
+    void match(const Query& query, const Result* last, std::vector<quint8>& counts, Result& out) const;
+    void candidates(const Query& query, const Result* last, std::vector<quint8>& counts, std::vector<Candidate>& out) const;
+    void verify(const Query& query, const std::vector<Candidate>& candidates, Result& out) const;
+
+    // The case folded text of each of the text columns, row after row, and
+    // where each one starts, with the end of the last one after them. Then the
+    // code of each of the encoded columns, row after row.
+    std::vector<QChar> letters;
+    std::vector<quint64> starts;
+    std::vector<DictionaryCode> codes;
+    // The rows that have each trigram of the text columns, in order. Each one
+    // is stored as the row shifted up, with a bit for each text column that
+    // has the trigram in the bottom bits.
+    QHash<quint64, std::vector<quint32>> postings;
+    // For each of the encoded columns, the rows that have each code. Only the
+    // encoded columns are used.
+    std::vector<std::vector<int>> codeRows[COLUMN_COUNT];
+    // How many of the rows have been indexed.
+    int rowCount;
+
+    // The text and codes of the rows that were added but haven't been indexed
+    // yet, row after row. The thread indexing them takes them out in batches.
+    std::mutex addedLock;
+    std::vector<QString> addedText;
+    std::vector<DictionaryCode> addedCodes;
+    // Whether a thread is indexing them, which indexer is waited on for.
+    bool indexing;
+    // How many rows have been added, indexed or not.
+    int addedCount;
+    std::future<void> indexer;
+    // Set to make the thread indexing rows give up.
+    std::atomic<bool> cancelled;
+
+    // The searches that led up to the last one, each one starting with the
+    // text of the one before it.
+    QVector<Result> history;
+    // How many rows had been indexed when history was worked out.
+    int searchedRows;
+    // The matches of the last search, best first.
+    QVector<SearchMatch> ranked;
+    // How many of the search's trigrams each text column of each row has.
+    // Kept around so it doesn't have to be allocated again for every search.
+    std::vector<quint8> counts;
+
+    // The matches of a search allowing more edits than its length does, being
+    // worked out in the background for the next letter. Only its matches and
+    // fields are filled in by widener, and they can't be used until it has
+    // finished.
+    Result wider;
+    std::future<void> widener;
+    std::vector<quint8> widerCounts;
+};
+
+#endif
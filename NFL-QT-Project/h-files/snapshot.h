@@ -0,0 +1,36 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include "sort.h"
+#include "teamrecord.h"
+
+// A snapshot is a copy of the teams of a csv file that have already been read,
+// kept in the cache folder. It holds each column as an array of its real type
+// (text as UTF-16, the encoded columns as codes with the text of each code) and
+// the order of the teams for every column and direction they can be sorted by.
+// Reading it is a matter of mapping it into memory and pointing at it, so the
+// program can start without reading the csv file again. It is only used while
+// the csv file has the same size, modification time and contents as the one
+// it was made from, and while text is sorted in the same locale as it was
+// then, since the orders of the text columns depend on it. Anything else (an
+// old version, another kind of computer, a damaged file) is treated the same
+// as not having a snapshot.
+
+// What a csv file looked like when it was read, so a snapshot made from it
+// can tell if the file has changed since.
+struct SnapshotSource
+{
+    quint64 size;
+    qint64 modified;
+    quint64 hash;
+};
+
+bool readSnapshotSource(const QString& csvPath, SnapshotSource& out);
+QString snapshotPath(const QString& csvPath);
+bool readSnapshot(const QString& csvPath, QVector<TeamRecord>& out, SortedOrderCache* orders = nullptr);
+bool writeSnapshot(const QString& csvPath, const SnapshotSource& source, const QVector<TeamRecord>& records);
+
+#endif
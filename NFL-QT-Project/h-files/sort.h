@@ -2,12 +2,69 @@
 #ifndef SORT_H
 #define SORT_H
 
-#include <array>
-#include <QTableWidgetItem>
-#include "utils.h"
+#include <QHash>
+#include <QVector>
+#include <vector>
+#include "teamrecord.h"
 
-void sortColumn(QVector<std::array<QTableWidgetItem*, 10>>& rows, int start, int end, int column, bool ascending);
+// One column to sort by and which way to sort it.
+struct SortKey
+{
+    Column column;
+    bool ascending;
+};
 
-bool operator==(const QTableWidgetItem& first, const QTableWidgetItem& second);
+// Remembers the order of the values in each column between sorts, so they
+// only have to be compared with each other once. Text columns keep the rank of
+// every value they have seen, which is worked out again when a new one shows
+// up. Encoded columns rank their dictionary's codes.
+class SortKeyCache
+{
+public:
+    void columnKeys(const QVector<const TeamRecord*>& rows, const SortKey& key, std::vector<quint32>& out, std::size_t threads = 1);
+    bool rowKey(const TeamRecord& record, Column column, quint32& out);
+    void clear();
+
+private:
+    void rankText(const QVector<const TeamRecord*>& rows, Column column);
+    const std::vector<quint32>& codeRanks(Column column);
+
+    QHash<QString, quint32> textRanks[COLUMN_COUNT];
+    std::vector<quint32> encodedRanks[COLUMN_COUNT];
+};
+
+bool compareRecords(const TeamRecord* first, const TeamRecord* second, const QVector<SortKey>& keys);
+
+void sortOrder(const QVector<const TeamRecord*>& rows, const QVector<SortKey>& keys, std::vector<int>& order, SortKeyCache* cache = nullptr, std::size_t threads = 0);
+void sortRecords(QVector<const TeamRecord*>& rows, const QVector<SortKey>& keys, SortKeyCache* cache = nullptr);
+
+QVector<SortKey> sortKeysFor(Column column, bool ascending);
+
+// Keeps the sorted order of a set of rows (as indexes into it) for each column
+// and direction the user can sort by, so switching between them or showing a
+// different part of the rows doesn't have to sort anything again. Rows can be
+// added to the end without losing the cached orders.
+class SortedOrderCache
+{
+public:
+    SortedOrderCache();
+
+    const std::vector<int>& order(const QVector<const TeamRecord*>& rows, Column column, bool ascending, SortKeyCache* keys);
+    void rowsAppended(const QVector<const TeamRecord*>& rows, int firstNew, SortKeyCache* keys);
+    void preset(Column column, bool ascending, const quint32* order, int size);
+    void clear();
+
+private:
+    bool usePreset(int slot, int rowCount);
+
+    std::vector<int> orders[COLUMN_COUNT * 2];
+    bool valid[COLUMN_COUNT * 2];
+    // Orders that were worked out before the rows were loaded (like the ones
+    // in a snapshot), which are only copied into orders once they are needed.
+    // Rows added to the end before then are merged in at the same time.
+    // Whoever hands them over has to keep them alive for as long as the cache.
+    const quint32* presets[COLUMN_COUNT * 2];
+    int presetSizes[COLUMN_COUNT * 2];
+};
 
 #endif
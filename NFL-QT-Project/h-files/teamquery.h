@@ -0,0 +1,54 @@
+#ifndef TEAMQUERY_H
+#define TEAMQUERY_H
+
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "filterexpression.h"
+#include "groupsummary.h"
+#include "searchindex.h"
+#include "sort.h"
+#include "teamrecord.h"
+
+// The values of one team or group of teams being written out, and which of
+// them are numbers (which JSON doesn't put in quotes).
+struct QueryRow
+{
+    QStringList values;
+    QVector<bool> numbers;
+
+    void add(const QString& value, bool number);
+};
+
+// What selectRows can keep between queries of the same rows, so it doesn't
+// work them out again for every query. The locks let any number of threads
+// share it.
+struct SelectionCache
+{
+    QMutex searchLock;
+    SearchIndex search;
+    QMutex sortLock;
+    SortKeyCache sortKeys;
+    SortedOrderCache sortedOrders;
+};
+
+// Reading the columns a query sorts and groups by, and writing out the teams
+// and group totals it finds, the same way for every program that answers
+// queries without the table.
+bool parseSortKeys(const QString& text, QVector<SortKey>& out, QString* error = nullptr);
+bool parseGroupBy(const QString& text, Column& first, int& second, QString* error = nullptr);
+
+void selectRows(const QVector<const TeamRecord*>& rows, FilterExpression& expression, const QString& search,
+                const QVector<SortKey>& sortKeys, int onlyFirst, QVector<const TeamRecord*>& out, SelectionCache* cache = nullptr);
+
+QStringList teamFieldNames();
+void teamFields(const TeamRecord& record, QueryRow& out);
+QStringList groupFieldNames(Column first, int second);
+void groupFields(const GroupTotals& group, int second, QueryRow& out);
+
+QString csvField(const QString& text);
+QString jsonString(const QString& text);
+QString jsonObject(const QStringList& names, const QueryRow& row);
+
+#endif
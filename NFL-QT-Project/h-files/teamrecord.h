@@ -0,0 +1,131 @@
+#ifndef TEAMRECORD_H
+#define TEAMRECORD_H
+
+#include <QString>
+#include <QtGlobal>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "dictionary.h"
+
+// The columns of the table, in the same order as the columns of the csv files.
+enum class Column : int
+{
+    TeamName,
+    StadiumName,
+    SeatingCapacity,
+    City,
+    State,
+    Conference,
+    Division,
+    SurfaceType,
+    RoofType,
+    YearOpened
+};
+
+const int COLUMN_COUNT = 10;
+
+// One team (one line of a csv file). The numbers are parsed once when the file
+// is loaded so nothing has to convert them again when sorting or adding up the
+// capacities. The columns that only have a few different values between all of
+// the teams are stored as codes from columnDictionary().
+struct TeamRecord
+{
+    QString teamName;
+    QString stadiumName;
+    quint32 seatingCapacity;
+    QString city;
+    QString state;
+    DictionaryCode conference;
+    DictionaryCode division;
+    DictionaryCode surfaceType;
+    DictionaryCode roofType;
+    quint16 yearOpened;
+
+    QString text(Column column) const;
+
+    static bool fromFields(const std::vector<std::string_view>& fields, TeamRecord& out, QString* error = nullptr);
+};
+
+// Compile time information about each column: the type it is stored as, where
+// it is in a TeamRecord and what it is called.
+template <Column column>
+struct ColumnTraits;
+
+// How the values of a column are stored in a TeamRecord.
+enum class ColumnKind
+{
+    Text,
+    Number,
+    // A number that is shown with thousands separators.
+    GroupedNumber,
+    // A code from the column's dictionary.
+    Encoded
+};
+
+template <typename T, T TeamRecord::* M, ColumnKind Kind>
+struct ColumnTraitsBase
+{
+    typedef T Type;
+    static constexpr T TeamRecord::* member = M;
+    static constexpr ColumnKind kind = Kind;
+    static constexpr bool numeric = Kind == ColumnKind::Number || Kind == ColumnKind::GroupedNumber;
+    static constexpr bool grouped = Kind == ColumnKind::GroupedNumber;
+    static constexpr bool encoded = Kind == ColumnKind::Encoded;
+};
+
+template <> struct ColumnTraits<Column::TeamName> : ColumnTraitsBase<QString, &TeamRecord::teamName, ColumnKind::Text> { static constexpr const char* name = "Team Name"; };
+template <> struct ColumnTraits<Column::StadiumName> : ColumnTraitsBase<QString, &TeamRecord::stadiumName, ColumnKind::Text> { static constexpr const char* name = "Stadium Name"; };
+template <> struct ColumnTraits<Column::SeatingCapacity> : ColumnTraitsBase<quint32, &TeamRecord::seatingCapacity, ColumnKind::GroupedNumber> { static constexpr const char* name = "Seating Capacity"; };
+template <> struct ColumnTraits<Column::City> : ColumnTraitsBase<QString, &TeamRecord::city, ColumnKind::Text> { static constexpr const char* name = "City"; };
+template <> struct ColumnTraits<Column::State> : ColumnTraitsBase<QString, &TeamRecord::state, ColumnKind::Text> { static constexpr const char* name = "State"; };
+template <> struct ColumnTraits<Column::Conference> : ColumnTraitsBase<DictionaryCode, &TeamRecord::conference, ColumnKind::Encoded> { static constexpr const char* name = "Conference"; };
+template <> struct ColumnTraits<Column::Division> : ColumnTraitsBase<DictionaryCode, &TeamRecord::division, ColumnKind::Encoded> { static constexpr const char* name = "Division"; };
+template <> struct ColumnTraits<Column::SurfaceType> : ColumnTraitsBase<DictionaryCode, &TeamRecord::surfaceType, ColumnKind::Encoded> { static constexpr const char* name = "Surface Type"; };
+template <> struct ColumnTraits<Column::RoofType> : ColumnTraitsBase<DictionaryCode, &TeamRecord::roofType, ColumnKind::Encoded> { static constexpr const char* name = "Stadium Roof Type"; };
+template <> struct ColumnTraits<Column::YearOpened> : ColumnTraitsBase<quint16, &TeamRecord::yearOpened, ColumnKind::Number> { static constexpr const char* name = "Date Opened"; };
+
+// Gets the value of a column from a record with its real type.
+template <Column column>
+const typename ColumnTraits<column>::Type& get(const TeamRecord& record)
+{
+    return record.*ColumnTraits<column>::member;
+}
+
+// Calls :param function: with a std::integral_constant for the column, which
+// turns a column only known at run time (like the one a user clicked on) into
+// one the templates above can use.
+template <typename Function>
+auto visitColumn(Column column, Function&& function)
+{
+    switch (column)
+    {
+    case Column::TeamName: return function(std::integral_constant<Column, Column::TeamName>());
+    case Column::StadiumName: return function(std::integral_constant<Column, Column::StadiumName>());
+    case Column::SeatingCapacity: return function(std::integral_constant<Column, Column::SeatingCapacity>());
+    case Column::City: return function(std::integral_constant<Column, Column::City>());
+    case Column::State: return function(std::integral_constant<Column, Column::State>());
+    case Column::Conference: return function(std::integral_constant<Column, Column::Conference>());
+    case Column::Division: return function(std::integral_constant<Column, Column::Division>());
+    case Column::SurfaceType: return function(std::integral_constant<Column, Column::SurfaceType>());
+    case Column::RoofType: return function(std::integral_constant<Column, Column::RoofType>());
+    default: return function(std::integral_constant<Column, Column::YearOpened>());
+    }
+}
+
+const char* columnName(Column column);
+bool isNumericColumn(Column column);
+bool isEncodedColumn(Column column);
+bool findColumn(QString name, Column& out);
+
+// The dictionary that holds the values of an encoded column.
+Dictionary& columnDictionary(Column column);
+
+// Compares one column of two records, returning less than 0, 0 or greater than
+// 0 like QString::compare. Numbers are compared as numbers and text is compared
+// with QString::localeAwareCompare, which is how the table items sorted it
+// before there were records. Encoded columns compare their text, not their
+// codes, since codes are handed out in the order values are first seen.
+int compareColumn(const TeamRecord& first, const TeamRecord& second, Column column);
+
+#endif
@@ -1,16 +1,47 @@
 #ifndef DESTRUCTION_UTILS_H
 #define DESTRUCTION_UTILS_H
 
+#include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 #include <QVector>
-#include <array>
-#include <QTableWidgetItem>
+#include <functional>
+#include <string>
+#include "teamrecord.h"
+
+// Why reading a file of teams didn't work.
+struct LoadError
+{
+    enum Kind
+    {
+        None,
+        // The file couldn't be opened.
+        FileNotFound,
+        // The file isn't a valid CSV file, or its lines aren't all as wide.
+        BadFormat,
+        // A line is valid CSV but isn't a valid team.
+        BadRecord,
+        Cancelled
+    };
+
+    Kind kind = None;
+    // What went wrong, in a way that can be shown to the user.
+    QString message;
+    // The line the problem is on (starting at 1), or 0 if it isn't on one.
+    std::size_t line = 0;
+};
+
+// Called while a file is being read with how many bytes have been read and how
+// big the file is. Returning false stops reading the file.
+typedef std::function<bool(std::size_t done, std::size_t total)> LoadProgress;
 
 bool isCommaNumber(QString data);
 
 unsigned long long qvarToULongLong(QVariant var, bool* okay = nullptr);
 
-bool loadRowsFromFile(std::string path, QVector<std::array<QTableWidgetItem*, 10>>& out);
+bool readRowsFromFile(const std::string& path, QVector<TeamRecord>& out, LoadError* error = nullptr, const LoadProgress& progress = LoadProgress());
+
+void mergeUpdates(const QVector<TeamRecord>& readEntries, QSet<QString>& teamNames, QVector<TeamRecord>& updates, QStringList* duplicates = nullptr);
 
 #endif